@@ -1,42 +1,11 @@
 #include "drone.h"
 
-using namespace obj3D;
-
-Mesh *Drone::createBaseMesh(const std::string &name, glm::vec3 center,
-	float l, float L, float h)
-{
-	float angles[2] = { RADIANS(45), RADIANS(-45) };
+#include <cmath>
 
-	Mesh *ends[4];
-
-	for (int i = 0; i < 4; i++) {
-		float di = (i > 1) ? 1 : -1;
-		float dj = 1 - (i % 2) * 2;
-		float angle = angles[(i > 1) ? 1 - i % 2 : i % 2];
-
-		float dx = di * abs(cos(angle)) * (L / 2.f);
-		float dz = dj * abs(sin(angle)) * (L / 2.f);
-
-		ends[i] = createRectangleParallelepiped("", center + glm::vec3(dx, 0, dz),
-			l + 0.1f, L / 10.f, h * 1.5f, COLOR_LIGHT_GREY, angle);
-	}
-
-	auto p1 = createRectangleParallelepiped("", center, l, L, h, COLOR_LIGHT_GREY, angles[0]);
-	auto p2 = createRectangleParallelepiped("", center, l, L, h, COLOR_LIGHT_GREY, angles[1]);
-
-	auto res = combineMeshes(name, { ends[0], ends[1], ends[2], ends[3], p1, p2 });
-	res->SetDrawMode(GL_TRIANGLES);
-
-	return res;
-}
+using namespace obj3D;
 
 glm::mat4 Drone::getBaseMatrix() const
 {
-	if (target != nullptr) {
-		target->angle = angle;
-		target->pos = pos - glm::vec3(0, DRONE_h * size / 2.f + target->size / 3.f + 0.01f, 0);
-	}
-
 	auto modelMatrix = glm::mat4(1);
 
 	modelMatrix = glm::translate(modelMatrix, pos);
@@ -48,13 +17,20 @@ glm::mat4 Drone::getBaseMatrix() const
 
 std::vector<glm::mat4> Drone::getBladeMatrices() const
 {
-	std::vector<glm::mat4> res;
+	std::vector<glm::mat4> res(DRONE_NR_BLADES);
+	getBladeMatrices(res.data());
+
+	return res;
+}
+
+void Drone::getBladeMatrices(glm::mat4 *out) const
+{
 	float halfL = DRONE_L * size / 2.f;
 	float h = size * (DRONE_L / 10.f + DRONE_h / 8.f + 0.02f);
 
 	float angleSgn[2] = { 1, -1 };
 
-	for (int i = 0; i < 4; i++) {
+	for (int i = 0; i < DRONE_NR_BLADES; i++) {
 		float di = (i > 1) ? 1 : -1;
 		float dj = 1 - (i % 2) * 2;
 
@@ -71,10 +47,8 @@ std::vector<glm::mat4> Drone::getBladeMatrices() const
 		mat = glm::rotate(mat, angle + bladeAngle, glm::vec3(0, 1, 0));
 		mat = glm::scale(mat, glm::vec3(size * 2.f, size, size));
 
-		res.push_back(mat);
+		out[i] = mat;
 	}
-
-	return res;
 }
 
 glm::mat4 Target::getMatrix() const
@@ -96,6 +70,14 @@ glm::mat4 Target::getDeliverMatrix() const
 	return modelMatrix;
 }
 
+void Drone::carryTarget()
+{
+	if (target != nullptr) {
+		target->angle = angle;
+		target->pos = pos - glm::vec3(0, DRONE_h * size / 2.f + target->size / 3.f + 0.01f, 0);
+	}
+}
+
 void Drone::acquireTarget(Target &target)
 {
 	if (this->target != nullptr) {
@@ -114,8 +96,8 @@ void Drone::acquireTarget(Target &target)
 		return;
 	}
 
-	if (abs(pos.x - target.pos.x) <= targetL + 0.2f
-		&& abs(pos.z - target.pos.z) <= targetL + 0.2f) {
+	if (std::abs(pos.x - target.pos.x) <= targetL + 0.2f
+		&& std::abs(pos.z - target.pos.z) <= targetL + 0.2f) {
 		this->target = &target;
 	}
 }
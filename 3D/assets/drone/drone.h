@@ -1,14 +1,19 @@
 #pragma once
 
-#include "core/gpu/mesh.h"
+#include <string>
+#include <vector>
+#include <utility>
 
-#include "../../objects.h"
-#include "../../../color.h"
+#include "utils/glm_utils.h"
+
+// Meshes are only built by the renderer, the simulation never touches the GPU
+class Mesh;
 
 #define DRONE_l 0.25f
 #define DRONE_L 1.75f
 #define DRONE_h 0.25f
 #define DRONE_SIZE 0.4f
+#define DRONE_NR_BLADES 4
 
 namespace obj3D {
 
@@ -34,19 +39,18 @@ namespace obj3D {
 	class Drone {
 	public:
 
-		static inline std::pair<Mesh *, Mesh *> createDroneMeshes(const std::string &name1,
-			const std::string &name2, glm::vec3 center)
-		{
-			return {
-				createBaseMesh(name1, center, DRONE_l, DRONE_L, DRONE_h),
-				createRectangleParallelepiped(name2, center, DRONE_l / 3.f, DRONE_L / 7.f, DRONE_h / 4.f, COLOR_BLACK)
-			};
-		}
+		static std::pair<Mesh *, Mesh *> createDroneMeshes(const std::string &name1,
+			const std::string &name2, glm::vec3 center);
 
 		glm::mat4 getBaseMatrix() const;
 
 		std::vector<glm::mat4> getBladeMatrices() const;
 
+		/**
+		 * Same as above, written to @a out[0..DRONE_NR_BLADES) without allocating
+		 */
+		void getBladeMatrices(glm::mat4 *out) const;
+
 		glm::vec3 pos;
 		float size = 1;
 
@@ -57,6 +61,11 @@ namespace obj3D {
 
 		void acquireTarget(Target &target);
 
+		/**
+		 * Moves the carried target under the drone
+		 */
+		void carryTarget();
+
 	private:
 		static Mesh *createBaseMesh(const std::string &name, glm::vec3 center,
 			float l, float L, float h);
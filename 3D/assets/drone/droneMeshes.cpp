@@ -0,0 +1,40 @@
+#include "drone.h"
+
+#include "../../objects.h"
+#include "../../../color.h"
+
+using namespace obj3D;
+
+std::pair<Mesh *, Mesh *> Drone::createDroneMeshes(const std::string &name1,
+	const std::string &name2, glm::vec3 center)
+{
+	return {
+		createBaseMesh(name1, center, DRONE_l, DRONE_L, DRONE_h),
+		createRectangleParallelepiped(name2, center, DRONE_l / 3.f, DRONE_L / 7.f, DRONE_h / 4.f, COLOR_BLACK)
+	};
+}
+
+Mesh *Drone::createBaseMesh(const std::string &name, glm::vec3 center,
+	float l, float L, float h)
+{
+	float angles[2] = { RADIANS(45), RADIANS(-45) };
+
+	MeshData base;
+
+	for (int i = 0; i < 4; i++) {
+		float di = (i > 1) ? 1 : -1;
+		float dj = 1 - (i % 2) * 2;
+		float angle = angles[(i > 1) ? 1 - i % 2 : i % 2];
+
+		float dx = di * abs(cos(angle)) * (L / 2.f);
+		float dz = dj * abs(sin(angle)) * (L / 2.f);
+
+		base.append(makeRectangleParallelepiped(center + glm::vec3(dx, 0, dz),
+			l + 0.1f, L / 10.f, h * 1.5f, COLOR_LIGHT_GREY, angle));
+	}
+
+	base.append(makeRectangleParallelepiped(center, l, L, h, COLOR_LIGHT_GREY, angles[0]));
+	base.append(makeRectangleParallelepiped(center, l, L, h, COLOR_LIGHT_GREY, angles[1]));
+
+	return base.upload(name);
+}
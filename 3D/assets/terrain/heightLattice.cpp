@@ -0,0 +1,69 @@
+#include "heightLattice.h"
+#include "../../threadPool.h"
+
+#include <algorithm>
+
+using namespace obj3D;
+
+void HeightLattice::init(float x0, float z0, int sizeX, int sizeZ, int resolution)
+{
+	this->x0 = x0;
+	this->z0 = z0;
+	this->resolution = std::max(1, resolution);
+
+	nrX = sizeX * this->resolution + 1;
+	nrZ = sizeZ * this->resolution + 1;
+
+	values.assign(static_cast<size_t>(nrX) * nrZ, 0.f);
+}
+
+void HeightLattice::bake(float x0, float z0, int sizeX, int sizeZ, int resolution,
+	const std::function<float(float, float)> &valueAt, ThreadPool *pool)
+{
+	init(x0, z0, sizeX, sizeZ, resolution);
+
+	float step = 1.f / this->resolution;
+
+	auto bakeRow = [&](size_t j) {
+		for (int i = 0; i < nrX; i++) {
+			values[j * nrX + i] = valueAt(x0 + i * step, z0 + j * step);
+		}
+	};
+
+	parallelFor(pool, nrZ, bakeRow);
+}
+
+void HeightLattice::assign(float x0, float z0, int sizeX, int sizeZ, int resolution,
+	const float *values)
+{
+	init(x0, z0, sizeX, sizeZ, resolution);
+	std::copy(values, values + this->values.size(), this->values.begin());
+}
+
+void HeightLattice::clear()
+{
+	values.clear();
+	nrX = 0;
+	nrZ = 0;
+}
+
+float HeightLattice::sample(float x, float z) const
+{
+	if (values.empty()) {
+		return 0;
+	}
+
+	float fx = std::min(std::max((x - x0) * resolution, 0.f), static_cast<float>(nrX - 1));
+	float fz = std::min(std::max((z - z0) * resolution, 0.f), static_cast<float>(nrZ - 1));
+
+	int i = std::min(static_cast<int>(fx), std::max(nrX - 2, 0));
+	int j = std::min(static_cast<int>(fz), std::max(nrZ - 2, 0));
+
+	float u = fx - i;
+	float v = fz - j;
+
+	int i1 = std::min(i + 1, nrX - 1);
+	int j1 = std::min(j + 1, nrZ - 1);
+
+	return glm::mix(glm::mix(at(i, j), at(i1, j), u), glm::mix(at(i, j1), at(i1, j1), u), v);
+}
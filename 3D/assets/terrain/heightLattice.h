@@ -0,0 +1,80 @@
+#pragma once
+
+#include <vector>
+#include <functional>
+
+#include "utils/glm_utils.h"
+
+namespace obj3D {
+
+	class ThreadPool;
+
+	/**
+	 * Values of a function over the X/Z plane, sampled @a resolution
+	 * times per unit on a regular lattice and read back bilinearly
+	 * Sampling exactly on a lattice point gives back the stored value
+	 */
+	class HeightLattice {
+	public:
+		HeightLattice() {}
+
+		/**
+		 * Covers [@a x0, @a x0 + @a sizeX] x [@a z0, @a z0 + @a sizeZ]
+		 * Rows are spread over @a pool if given, @a valueAt must be thread safe
+		 */
+		void bake(float x0, float z0, int sizeX, int sizeZ, int resolution,
+			const std::function<float(float, float)> &valueAt, ThreadPool *pool = nullptr);
+
+		/**
+		 * Same as bake(), with the values already computed, row by row
+		 */
+		void assign(float x0, float z0, int sizeX, int sizeZ, int resolution,
+			const float *values);
+
+		void clear();
+
+		/**
+		 * Positions outside of the lattice are moved to its border
+		 */
+		float sample(float x, float z) const;
+
+		inline int getResolution() const
+		{
+			return resolution;
+		}
+		inline const std::vector<float> &getValues() const
+		{
+			return values;
+		}
+		inline size_t memoryUsage() const
+		{
+			return values.capacity() * sizeof(float);
+		}
+
+		/**
+		 * Number of values for a lattice over @a sizeX x @a sizeZ units
+		 */
+		static inline size_t nrValues(int sizeX, int sizeZ, int resolution)
+		{
+			return (static_cast<size_t>(sizeX) * resolution + 1) * (static_cast<size_t>(sizeZ) * resolution + 1);
+		}
+
+	private:
+		std::vector<float> values;
+
+		float x0 = 0;
+		float z0 = 0;
+		int resolution = 1;
+
+		int nrX = 0;
+		int nrZ = 0;
+
+		void init(float x0, float z0, int sizeX, int sizeZ, int resolution);
+
+		inline float at(int i, int j) const
+		{
+			return values[j * nrX + i];
+		}
+	};
+
+} // namespace obj3D
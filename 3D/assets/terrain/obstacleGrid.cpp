@@ -0,0 +1,45 @@
+#include "obstacleGrid.h"
+
+using namespace obj3D;
+
+void ObstacleGrid::init(float minX, float minZ, float maxX, float maxZ, float cellSize)
+{
+	this->minX = minX;
+	this->minZ = minZ;
+	this->cellSize = cellSize;
+
+	nrCellsX = std::max(1, static_cast<int>(std::ceil((maxX - minX) / cellSize)));
+	nrCellsZ = std::max(1, static_cast<int>(std::ceil((maxZ - minZ) / cellSize)));
+
+	cells.clear();
+	cells.resize(nrCellsX * nrCellsZ);
+}
+
+void ObstacleGrid::clear()
+{
+	for (auto &&cell : cells) {
+		cell.clear();
+	}
+}
+
+size_t ObstacleGrid::memoryUsage() const
+{
+	size_t bytes = cells.capacity() * sizeof(cells[0]);
+
+	for (auto &&cell : cells) {
+		bytes += cell.capacity() * sizeof(ObstacleId);
+	}
+	return bytes;
+}
+
+void ObstacleGrid::insert(ObstacleId id, float centerX, float centerZ, float extent)
+{
+	int x0 = cellX(centerX - extent), x1 = cellX(centerX + extent);
+	int z0 = cellZ(centerZ - extent), z1 = cellZ(centerZ + extent);
+
+	for (int x = x0; x <= x1; x++) {
+		for (int z = z0; z <= z1; z++) {
+			cells[z * nrCellsX + x].push_back(id);
+		}
+	}
+}
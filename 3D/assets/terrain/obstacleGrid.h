@@ -0,0 +1,89 @@
+#pragma once
+
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+#define OBSTACLE_GRID_CELL 2.f
+
+namespace obj3D {
+
+	/**
+	 * Compact handle of an obstacle, resolved by whoever filled the grid
+	 */
+	typedef uint32_t ObstacleId;
+
+	/**
+	 * Uniform bucket grid over the X/Z plane
+	 * Every obstacle is stored in all the cells its footprint overlaps,
+	 * so a query only has to look at the cells covered by the queried area
+	 */
+	class ObstacleGrid {
+	public:
+		ObstacleGrid() {}
+
+		void init(float minX, float minZ, float maxX, float maxZ, float cellSize);
+		void clear();
+
+		/**
+		 * @a extent is the half size of the obstacle footprint
+		 */
+		void insert(ObstacleId id, float centerX, float centerZ, float extent);
+
+		/**
+		 * Bytes held by the cells
+		 */
+		size_t memoryUsage() const;
+
+		/**
+		 * Returns true if @a pred holds for any obstacle stored in the
+		 * cells overlapped by the given area
+		 * The same obstacle may be tested more than once
+		 */
+		template <typename Pred>
+		bool any(float fromX, float fromZ, float toX, float toZ, Pred pred) const
+		{
+			if (cells.empty()) {
+				return false;
+			}
+
+			int x0 = cellX(fromX), x1 = cellX(toX);
+			int z0 = cellZ(fromZ), z1 = cellZ(toZ);
+
+			for (int x = x0; x <= x1; x++) {
+				for (int z = z0; z <= z1; z++) {
+					for (ObstacleId id : cells[z * nrCellsX + x]) {
+						if (pred(id)) {
+							return true;
+						}
+					}
+				}
+			}
+
+			return false;
+		}
+
+	private:
+		std::vector<std::vector<ObstacleId>> cells;
+
+		float minX = 0;
+		float minZ = 0;
+		float cellSize = 1;
+
+		int nrCellsX = 0;
+		int nrCellsZ = 0;
+
+		inline int cellX(float x) const
+		{
+			int cx = static_cast<int>(std::floor((x - minX) / cellSize));
+			return std::max(0, std::min(nrCellsX - 1, cx));
+		}
+		inline int cellZ(float z) const
+		{
+			int cz = static_cast<int>(std::floor((z - minZ) / cellSize));
+			return std::max(0, std::min(nrCellsZ - 1, cz));
+		}
+	};
+
+} // namespace obj3D
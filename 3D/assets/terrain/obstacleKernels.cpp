@@ -0,0 +1,231 @@
+#include "obstacleKernelsImpl.h"
+
+#include <random>
+#include <algorithm>
+
+#ifdef OBSTACLE_KERNELS_X86
+#include <emmintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+using namespace obj3D;
+
+#ifdef OBSTACLE_KERNELS_X86
+
+namespace {
+
+	struct SseOps {
+		typedef __m128 V;
+		static const int N = 4;
+
+		static inline V zero() { return _mm_setzero_ps(); }
+		static inline V set1(float f) { return _mm_set1_ps(f); }
+		static inline V load(const float *p) { return _mm_loadu_ps(p); }
+
+		static inline V add(V a, V b) { return _mm_add_ps(a, b); }
+		static inline V sub(V a, V b) { return _mm_sub_ps(a, b); }
+		static inline V mul(V a, V b) { return _mm_mul_ps(a, b); }
+		static inline V div(V a, V b) { return _mm_div_ps(a, b); }
+		static inline V sqrt(V a) { return _mm_sqrt_ps(a); }
+		static inline V abs(V a) { return _mm_andnot_ps(_mm_set1_ps(-0.f), a); }
+
+		static inline V lt(V a, V b) { return _mm_cmplt_ps(a, b); }
+		static inline V le(V a, V b) { return _mm_cmple_ps(a, b); }
+		static inline V gt(V a, V b) { return _mm_cmpgt_ps(a, b); }
+
+		static inline V andV(V a, V b) { return _mm_and_ps(a, b); }
+		static inline V orV(V a, V b) { return _mm_or_ps(a, b); }
+
+		// a and not b
+		static inline V andNot(V a, V b) { return _mm_andnot_ps(b, a); }
+
+		// SSE2 has no blend
+		static inline V select(V mask, V a, V b)
+		{
+			return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+		}
+
+		static inline int moveMask(V a) { return _mm_movemask_ps(a); }
+	};
+
+} // namespace
+
+static uint32_t hitBatchSse(ObstacleKind kind, const float *x, const float *z,
+	const float *size, const float *h, const DroneProbe &probe)
+{
+	return HitLanes<SseOps>::batch(kind, x, z, size, h, probe);
+}
+
+#endif
+
+static uint32_t hitBatchScalar(ObstacleKind kind, const float *x, const float *z,
+	const float *size, const float *h, const DroneProbe &probe)
+{
+	uint32_t mask = 0;
+
+	for (int i = 0; i < HIT_BATCH; i++) {
+		if (obstacleHit({ kind, x[i], z[i], size[i], h[i] }, probe)) {
+			mask |= 1u << i;
+		}
+	}
+
+	return mask;
+}
+
+typedef uint32_t (*HitKernel)(ObstacleKind, const float *, const float *,
+	const float *, const float *, const DroneProbe &);
+
+static HitKernel kernelFor(SimdLevel level)
+{
+	switch (level) {
+#ifdef OBSTACLE_KERNELS_X86
+	case SIMD_AVX2:
+		return hitBatchAvx2;
+	case SIMD_SSE:
+		return hitBatchSse;
+#endif
+	default:
+		return hitBatchScalar;
+	}
+}
+
+SimdLevel obj3D::detectSimdLevel()
+{
+#ifdef OBSTACLE_KERNELS_X86
+#ifdef _MSC_VER
+	int info[4];
+
+	__cpuid(info, 0);
+	int nrIds = info[0];
+
+	__cpuid(info, 1);
+	bool sse2 = (info[3] & (1 << 26)) != 0;
+	bool osxsave = (info[2] & (1 << 27)) != 0;
+	bool avx = (info[2] & (1 << 28)) != 0;
+
+	bool avx2 = false;
+
+	// The OS has to save the YMM registers too
+	if (nrIds >= 7 && osxsave && avx && (_xgetbv(0) & 6) == 6) {
+		__cpuidex(info, 7, 0);
+		avx2 = (info[1] & (1 << 5)) != 0;
+	}
+#else
+	__builtin_cpu_init();
+
+	bool sse2 = __builtin_cpu_supports("sse2");
+	bool avx2 = __builtin_cpu_supports("avx2");
+#endif
+
+	if (avx2) {
+		return SIMD_AVX2;
+	}
+	if (sse2) {
+		return SIMD_SSE;
+	}
+#endif
+
+	return SIMD_SCALAR;
+}
+
+static SimdLevel currentLevel = detectSimdLevel();
+static HitKernel currentKernel = kernelFor(currentLevel);
+
+SimdLevel obj3D::getSimdLevel()
+{
+	return currentLevel;
+}
+
+SimdLevel obj3D::setSimdLevel(SimdLevel level)
+{
+	currentLevel = std::min(level, detectSimdLevel());
+	currentKernel = kernelFor(currentLevel);
+
+	return currentLevel;
+}
+
+const char *obj3D::simdLevelName(SimdLevel level)
+{
+	switch (level) {
+	case SIMD_AVX2:
+		return "avx2";
+	case SIMD_SSE:
+		return "sse";
+	default:
+		return "scalar";
+	}
+}
+
+uint32_t obj3D::hitBatch(ObstacleKind kind, const float *x, const float *z,
+	const float *size, const float *h, size_t count, const DroneProbe &probe)
+{
+	uint32_t mask = currentKernel(kind, x, z, size, h, probe);
+
+	if (count < HIT_BATCH) {
+		mask &= (1u << count) - 1;
+	}
+	return mask;
+}
+
+/**
+ * Drones are thrown around and inside the obstacles, with a share of them
+ * placed right on the edges of the tests where rounding matters most
+ */
+size_t obj3D::checkHitKernels(unsigned int seed, size_t nrTests)
+{
+	std::mt19937 gen(seed);
+
+	std::uniform_real_distribution<float> distPos(-3.f, 3.f);
+	std::uniform_real_distribution<float> distY(-1.f, 12.f);
+	std::uniform_real_distribution<float> distScale(4.f, 10.f);
+	std::uniform_real_distribution<float> distUnit(0.f, 1.f);
+
+	SimdLevel best = detectSimdLevel();
+	size_t mismatches = 0;
+
+	float x[HIT_BATCH], z[HIT_BATCH], size[HIT_BATCH], h[HIT_BATCH];
+
+	for (size_t test = 0; test < nrTests; test += HIT_BATCH) {
+		DroneProbe probe;
+		float droneSize = DRONE_SIZE * (0.5f + distUnit(gen));
+
+		probe.pos = glm::vec3(distPos(gen), distY(gen), distPos(gen));
+		probe.rxz = droneSize * DRONE_L / 2.f;
+		probe.ry = droneSize * DRONE_h * 0.75f;
+		probe.hasTarget = distUnit(gen) < 0.5f;
+		probe.ryTarget = probe.hasTarget ? probe.ry + 0.3f / 1.5f : probe.ry;
+
+		ObstacleKind kind = (distUnit(gen) < 0.5f) ? OBSTACLE_TREE : OBSTACLE_BUILDING;
+
+		for (int i = 0; i < HIT_BATCH; i++) {
+			float scaleY = distScale(gen);
+			float scaleXZ = scaleY * 3.f / 5.f;
+
+			x[i] = distPos(gen);
+			z[i] = distPos(gen);
+			size[i] = (kind == OBSTACLE_TREE) ? scaleXZ * 0.5f : scaleXZ;
+			h[i] = scaleY;
+
+			// Exactly on the X border of a building, or the trunk of a tree
+			if (distUnit(gen) < 0.25f) {
+				float reach = (kind == OBSTACLE_TREE) ? size[i] / 5.f : size[i] / 4.f;
+				x[i] = probe.pos.x - (reach + probe.rxz);
+				z[i] = probe.pos.z;
+			}
+		}
+
+		uint32_t expected = hitBatchScalar(kind, x, z, size, h, probe);
+
+		for (int level = SIMD_SSE; level <= best; level++) {
+			uint32_t got = kernelFor(static_cast<SimdLevel>(level))(kind, x, z, size, h, probe);
+
+			for (uint32_t diff = got ^ expected; diff != 0; diff &= diff - 1) {
+				mismatches++;
+			}
+		}
+	}
+
+	return mismatches;
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "obstacleStore.h"
+
+// Obstacles tested against one drone by a single kernel call
+#define HIT_BATCH 8
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define OBSTACLE_KERNELS_X86
+#endif
+
+namespace obj3D {
+
+	enum SimdLevel { SIMD_SCALAR, SIMD_SSE, SIMD_AVX2, NR_SIMD_LEVELS };
+
+	/**
+	 * Best level supported by the CPU, the kernels start out using it
+	 */
+	SimdLevel detectSimdLevel();
+	SimdLevel getSimdLevel();
+
+	/**
+	 * Forces the kernels down to @a level, clamped to what the CPU supports
+	 * Returns the level actually used
+	 */
+	SimdLevel setSimdLevel(SimdLevel level);
+
+	const char *simdLevelName(SimdLevel level);
+
+	/**
+	 * Hit mask of the drone against @a count <= HIT_BATCH obstacles of
+	 * @a kind, bit i for obstacle i. Same answers as obstacleHit()
+	 * All arrays must hold HIT_BATCH values, the ones past @a count are ignored
+	 */
+	uint32_t hitBatch(ObstacleKind kind, const float *x, const float *z,
+		const float *size, const float *h, size_t count, const DroneProbe &probe);
+
+	/**
+	 * Compares every supported level against obstacleHit() on @a nrTests
+	 * random drone / obstacle pairs. Returns the number of disagreements
+	 */
+	size_t checkHitKernels(unsigned int seed, size_t nrTests);
+
+} // namespace obj3D
@@ -0,0 +1,72 @@
+/*
+ * Only the code below the target switch is compiled for AVX2, so that the
+ * rest of the game runs on any x86 CPU. Everything shared with other
+ * translation units, like the standard library and glm, is included
+ * before it: an AVX2 copy of an inline function could otherwise be the
+ * one kept by the linker. Only called once detectSimdLevel() found AVX2.
+ */
+
+#include "obstacleKernels.h"
+
+#ifdef OBSTACLE_KERNELS_X86
+
+#include <immintrin.h>
+
+#if defined(__clang__)
+#pragma clang attribute push(__attribute__((target("avx2"))), apply_to = function)
+#elif defined(__GNUC__)
+#pragma GCC push_options
+#pragma GCC target("avx2")
+#endif
+
+#include "obstacleKernelsImpl.h"
+
+using namespace obj3D;
+
+namespace {
+
+	struct Avx2Ops {
+		typedef __m256 V;
+		static const int N = 8;
+
+		static inline V zero() { return _mm256_setzero_ps(); }
+		static inline V set1(float f) { return _mm256_set1_ps(f); }
+		static inline V load(const float *p) { return _mm256_loadu_ps(p); }
+
+		static inline V add(V a, V b) { return _mm256_add_ps(a, b); }
+		static inline V sub(V a, V b) { return _mm256_sub_ps(a, b); }
+		static inline V mul(V a, V b) { return _mm256_mul_ps(a, b); }
+		static inline V div(V a, V b) { return _mm256_div_ps(a, b); }
+		static inline V sqrt(V a) { return _mm256_sqrt_ps(a); }
+		static inline V abs(V a) { return _mm256_andnot_ps(_mm256_set1_ps(-0.f), a); }
+
+		static inline V lt(V a, V b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+		static inline V le(V a, V b) { return _mm256_cmp_ps(a, b, _CMP_LE_OQ); }
+		static inline V gt(V a, V b) { return _mm256_cmp_ps(a, b, _CMP_GT_OQ); }
+
+		static inline V andV(V a, V b) { return _mm256_and_ps(a, b); }
+		static inline V orV(V a, V b) { return _mm256_or_ps(a, b); }
+
+		// a and not b
+		static inline V andNot(V a, V b) { return _mm256_andnot_ps(b, a); }
+
+		static inline V select(V mask, V a, V b) { return _mm256_blendv_ps(b, a, mask); }
+
+		static inline int moveMask(V a) { return _mm256_movemask_ps(a); }
+	};
+
+} // namespace
+
+uint32_t obj3D::hitBatchAvx2(ObstacleKind kind, const float *x, const float *z,
+	const float *size, const float *h, const DroneProbe &probe)
+{
+	return HitLanes<Avx2Ops>::batch(kind, x, z, size, h, probe);
+}
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#elif defined(__GNUC__)
+#pragma GCC pop_options
+#endif
+
+#endif
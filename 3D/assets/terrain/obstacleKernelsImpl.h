@@ -0,0 +1,121 @@
+#pragma once
+
+/*
+ * Lane-parallel versions of the obstacle hit tests, shared by the SSE and
+ * AVX2 kernels. Only included by the kernel translation units, each one
+ * instantiates the template with its own vector operations.
+ *
+ * Every operation is done in the same order as the scalar tests in
+ * obstacleStore.cpp. Both use IEEE single precision with a correctly
+ * rounded sqrt, so the answers are bit for bit the same. Squared
+ * distances are not used for that reason: comparing dx^2 + dz^2
+ * with a rounded r^2 flips borderline answers.
+ */
+
+#include "obstacleKernels.h"
+
+namespace obj3D {
+
+	// Implemented in obstacleKernelsAvx2.cpp, only called when the CPU has AVX2
+	uint32_t hitBatchAvx2(ObstacleKind kind, const float *x, const float *z,
+		const float *size, const float *h, const DroneProbe &probe);
+
+} // namespace obj3D
+
+namespace {
+
+	template <typename Ops>
+	struct HitLanes {
+		typedef typename Ops::V V;
+
+		static inline V cone(V py, V dist, V coneY, V coneR, V coneH, V ry, V rxz)
+		{
+			V outside = Ops::orV(Ops::lt(py, Ops::sub(coneY, ry)),
+				Ops::gt(py, Ops::add(Ops::add(coneY, coneH), Ops::div(ry, Ops::set1(2.f)))));
+
+			V d = Ops::abs(Ops::sub(py, coneY));
+
+			V m = Ops::div(Ops::sub(Ops::set1(0.05f), coneR), coneH);
+			V n = Ops::add(coneR, Ops::set1(0.01f));
+
+			V r = Ops::abs(Ops::add(Ops::mul(m, d), n));
+
+			return Ops::andNot(Ops::le(dist, Ops::add(r, rxz)), outside);
+		}
+
+		static inline V tree(const float *x, const float *z, const float *size, const float *h,
+			const obj3D::DroneProbe &p)
+		{
+			V px = Ops::set1(p.pos.x), py = Ops::set1(p.pos.y), pz = Ops::set1(p.pos.z);
+			V rxz = Ops::set1(p.rxz), ry = Ops::set1(p.ry);
+
+			V r = Ops::load(size);
+			V hv = Ops::load(h);
+
+			V dx = Ops::sub(px, Ops::load(x));
+			V dz = Ops::sub(pz, Ops::load(z));
+			V dist = Ops::sqrt(Ops::add(Ops::mul(dx, dx), Ops::mul(dz, dz)));
+
+			V five = Ops::set1(5.f);
+			V y1 = Ops::div(Ops::mul(Ops::set1(2.f), hv), five);
+			V y2 = Ops::div(Ops::mul(Ops::set1(4.f), hv), five);
+
+			// Both crowns are tested taller once the drone is above the lower one
+			V ryCrown = ry;
+			if (p.hasTarget) {
+				ryCrown = Ops::select(Ops::gt(py, y1), Ops::set1(p.ryTarget), ry);
+			}
+
+			V hit = cone(py, dist, y1, r, Ops::div(Ops::mul(Ops::set1(3.f), hv), five), ryCrown, rxz);
+			hit = Ops::orV(hit, cone(py, dist, y2, Ops::div(r, Ops::set1(2.f)),
+				Ops::div(Ops::mul(Ops::set1(2.f), hv), five), ryCrown, rxz));
+
+			// Trunk
+			V outside = Ops::orV(Ops::lt(py, Ops::sub(Ops::zero(), ry)),
+				Ops::gt(py, Ops::add(Ops::add(Ops::zero(), y2), ry)));
+			V trunk = Ops::andNot(Ops::le(dist, Ops::add(Ops::div(r, five), rxz)), outside);
+
+			return Ops::orV(hit, trunk);
+		}
+
+		static inline V building(const float *x, const float *z, const float *size, const float *h,
+			const obj3D::DroneProbe &p)
+		{
+			V px = Ops::set1(p.pos.x), py = Ops::set1(p.pos.y), pz = Ops::set1(p.pos.z);
+			V rxz = Ops::set1(p.rxz), ry = Ops::set1(p.ry);
+
+			V hv = Ops::load(h);
+
+			if (p.hasTarget) {
+				ry = Ops::select(Ops::gt(py, Ops::add(hv, ry)), Ops::set1(p.ryTarget), ry);
+			}
+			V above = Ops::gt(py, Ops::add(hv, ry));
+
+			V reach = Ops::add(Ops::div(Ops::load(size), Ops::set1(4.f)), rxz);
+			V inX = Ops::le(Ops::abs(Ops::sub(px, Ops::load(x))), reach);
+			V inZ = Ops::le(Ops::abs(Ops::sub(pz, Ops::load(z))), reach);
+
+			return Ops::andNot(Ops::andV(inX, inZ), above);
+		}
+
+		/**
+		 * HIT_BATCH lanes, in as many vectors as it takes
+		 */
+		static inline uint32_t batch(obj3D::ObstacleKind kind, const float *x, const float *z,
+			const float *size, const float *h, const obj3D::DroneProbe &p)
+		{
+			uint32_t mask = 0;
+
+			for (int i = 0; i < HIT_BATCH; i += Ops::N) {
+				V hit = (kind == obj3D::OBSTACLE_TREE)
+					? tree(x + i, z + i, size + i, h + i, p)
+					: building(x + i, z + i, size + i, h + i, p);
+
+				mask |= static_cast<uint32_t>(Ops::moveMask(hit)) << i;
+			}
+
+			return mask;
+		}
+	};
+
+} // namespace
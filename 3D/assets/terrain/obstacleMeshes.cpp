@@ -0,0 +1,22 @@
+#include "terrain.h"
+
+#include "../../objects.h"
+#include "../../../color.h"
+
+using namespace obj3D;
+
+Mesh *obj3D::createTree(const std::string &name, glm::vec3 corner, float h, float r)
+{
+	MeshData base = makeCylinder(corner, 4.f * h / 5.f, r / 5.f, COLOR_DARK_BROWN);
+	MeshData leaf1 = makeCone(corner + glm::vec3(0, 2.f * h / 5.f, 0),
+		3.f * h / 5.f, r, COLOR_GREEN);
+	MeshData leaf2 = makeCone(corner + glm::vec3(0, 4.f * h / 5.f, 0),
+		2.f * h / 5.f, r / 2.f, COLOR_GREEN);
+
+	return MeshData::merge({ base, leaf1, leaf2 }).upload(name);
+}
+
+Mesh *obj3D::createBuilding(const std::string &name, glm::vec3 center)
+{
+	return createRectangleParallelepiped(name, center, BUILDING_L, BUILDING_L, BUILDING_h, COLOR_DARK_GREY, 0);
+}
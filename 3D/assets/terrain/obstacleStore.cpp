@@ -0,0 +1,190 @@
+#include "obstacleStore.h"
+#include "obstacleKernels.h"
+
+#include <cmath>
+#include <algorithm>
+
+using namespace obj3D;
+
+void ObstacleStore::clear()
+{
+	for (auto &&c : columns) {
+		c.x.clear();
+		c.z.clear();
+		c.size.clear();
+		c.h.clear();
+	}
+}
+
+ObstacleId ObstacleStore::add(const ObstacleDesc &o)
+{
+	Columns &c = columns[o.kind];
+	auto index = static_cast<uint32_t>(c.x.size());
+
+	c.x.push_back(o.x);
+	c.z.push_back(o.z);
+	c.size.push_back(o.size);
+	c.h.push_back(o.h);
+
+	return makeObstacleId(o.kind, index);
+}
+
+size_t ObstacleStore::memoryUsage() const
+{
+	size_t bytes = 0;
+
+	for (auto &&c : columns) {
+		bytes += (c.x.capacity() + c.z.capacity() + c.size.capacity() + c.h.capacity()) * sizeof(float);
+	}
+	return bytes;
+}
+
+static bool coneHitDrone(glm::vec3 conePos, float coneR, float coneH,
+	glm::vec3 dronePos, float droneRXZ, float droneRY)
+{
+	if (dronePos.y < conePos.y - droneRY
+		|| dronePos.y > conePos.y + coneH + droneRY / 2.f) {
+		return false;
+	}
+
+	float d = std::abs(dronePos.y - conePos.y);
+
+	float m = (0.05f - coneR) / coneH;
+	float n = coneR + 0.01f;
+
+	float r = std::abs(m * d + n);
+
+	return glm::distance(dronePos, glm::vec3(conePos.x, dronePos.y, conePos.z))
+		<= r + droneRXZ;
+}
+
+static bool cylinderHitDrone(glm::vec3 cylPos, float cylR, float cylH,
+	glm::vec3 dronePos, float droneRXZ, float droneRY)
+{
+	if (dronePos.y < cylPos.y - droneRY
+		|| dronePos.y > cylPos.y + cylH + droneRY) {
+		return false;
+	}
+	return glm::distance(dronePos, glm::vec3(cylPos.x, dronePos.y, cylPos.z))
+		<= cylR + droneRXZ;
+}
+
+static bool buildingHitDrone(const ObstacleDesc &o, const DroneProbe &probe)
+{
+	float h = o.h;
+	float l = o.size;
+
+	float droneRY = probe.ry;
+
+	if (probe.pos.y > h + droneRY && probe.hasTarget) {
+		droneRY = probe.ryTarget;
+	}
+	if (probe.pos.y > h + droneRY) {
+		return false;
+	}
+
+	float actualL = l / 4.f;
+	return std::abs(probe.pos.x - o.x) <= actualL + probe.rxz
+		&& std::abs(probe.pos.z - o.z) <= actualL + probe.rxz;
+}
+
+static bool treeHitDrone(const ObstacleDesc &o, const DroneProbe &probe)
+{
+	float h = o.h;
+	float r = o.size;
+
+	auto pos1 = glm::vec3(o.x, 0, o.z) + glm::vec3(0, 2.f * h / 5.f, 0);
+	auto pos2 = glm::vec3(o.x, 0, o.z) + glm::vec3(0, 4.f * h / 5.f, 0);
+
+	// Both crowns are tested taller once the drone is above the lower one
+	float crownRY = (probe.pos.y > pos1.y && probe.hasTarget) ? probe.ryTarget : probe.ry;
+
+	if (coneHitDrone(pos1, r, 3.f * h / 5.f, probe.pos, probe.rxz, crownRY)) {
+		return true;
+	}
+	if (coneHitDrone(pos2, r / 2.f, 2.f * h / 5.f, probe.pos, probe.rxz, crownRY)) {
+		return true;
+	}
+
+	auto pos3 = glm::vec3(o.x, 0, o.z);
+	return cylinderHitDrone(pos3, r / 5.f, 4.f * h / 5.f, probe.pos, probe.rxz, probe.ry);
+}
+
+DroneProbe obj3D::makeDroneProbe(const Drone &drone)
+{
+	DroneProbe probe;
+
+	probe.pos = drone.pos;
+	probe.rxz = drone.size * DRONE_L / 2.f;
+	probe.ry = drone.size * DRONE_h * 0.75f;
+
+	probe.hasTarget = (drone.target != nullptr);
+	probe.ryTarget = probe.hasTarget ? probe.ry + drone.target->size / 1.5f : probe.ry;
+
+	return probe;
+}
+
+bool obj3D::obstacleHit(const ObstacleDesc &o, const DroneProbe &probe)
+{
+	switch (o.kind) {
+	case OBSTACLE_TREE:
+		return treeHitDrone(o, probe);
+	case OBSTACLE_BUILDING:
+		return buildingHitDrone(o, probe);
+	default:
+		return false;
+	}
+}
+
+glm::vec3 obj3D::obstacleNormal(const ObstacleDesc &o, const DroneProbe &probe)
+{
+	glm::vec3 up = glm::vec3(0, 1, 0);
+	float dx = probe.pos.x - o.x;
+	float dz = probe.pos.z - o.z;
+
+	if (o.kind == OBSTACLE_BUILDING) {
+		if (probe.pos.y > o.h) {
+			return up;
+		}
+
+		// The side the drone is furthest out of
+		if (std::abs(dx) >= std::abs(dz)) {
+			return glm::vec3(dx < 0 ? -1.f : 1.f, 0, 0);
+		}
+		return glm::vec3(0, 0, dz < 0 ? -1.f : 1.f);
+	}
+
+	// Trees are round, except for their top
+	float dist = std::sqrt(dx * dx + dz * dz);
+	if (probe.pos.y > 6.f * o.h / 5.f || dist == 0) {
+		return up;
+	}
+	return glm::vec3(dx / dist, 0, dz / dist);
+}
+
+bool ObstacleStore::anyHit(ObstacleKind kind, const uint32_t *indices, size_t count,
+	const DroneProbe &probe) const
+{
+	const Columns &c = columns[kind];
+
+	float x[HIT_BATCH] = {}, z[HIT_BATCH] = {}, size[HIT_BATCH] = {}, h[HIT_BATCH] = {};
+
+	for (size_t first = 0; first < count; first += HIT_BATCH) {
+		size_t n = std::min(count - first, static_cast<size_t>(HIT_BATCH));
+
+		for (size_t i = 0; i < n; i++) {
+			uint32_t idx = indices[first + i];
+
+			x[i] = c.x[idx];
+			z[i] = c.z[idx];
+			size[i] = c.size[idx];
+			h[i] = c.h[idx];
+		}
+
+		if (hitBatch(kind, x, z, size, h, n, probe) != 0) {
+			return true;
+		}
+	}
+
+	return false;
+}
@@ -0,0 +1,154 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cmath>
+
+#include "obstacleGrid.h"
+#include "../drone/drone.h"
+
+// Top bits of an ObstacleId hold the kind, the rest the index in that kind
+#define OBSTACLE_INDEX_BITS 28
+#define OBSTACLE_INDEX_MASK ((1u << OBSTACLE_INDEX_BITS) - 1)
+
+namespace obj3D {
+
+	enum ObstacleKind : uint8_t { OBSTACLE_TREE, OBSTACLE_BUILDING, NR_OBSTACLE_KINDS };
+
+	/**
+	 * A single obstacle by value
+	 * Tree: @a size is the radius of the lower crown,
+	 * building: @a size is the side of the base
+	 */
+	struct ObstacleDesc {
+		ObstacleKind kind;
+		float x;
+		float z;
+		float size;
+		float h;
+	};
+
+	/**
+	 * Half size of the X/Z area in which the obstacle can be hit
+	 */
+	inline float obstacleExtent(const ObstacleDesc &o)
+	{
+		return (o.kind == OBSTACLE_TREE) ? o.size + 0.01f : o.size / 4.f;
+	}
+
+	/**
+	 * Radius of the area kept clear of other obstacles
+	 */
+	inline float obstacleFootprint(const ObstacleDesc &o)
+	{
+		return (o.kind == OBSTACLE_TREE) ? o.size : o.size / 3.f;
+	}
+
+	inline bool obstaclesIntersect(const ObstacleDesc &a, const ObstacleDesc &b)
+	{
+		float dx = a.x - b.x;
+		float dz = a.z - b.z;
+		float reach = obstacleFootprint(a) + obstacleFootprint(b) + 0.1f;
+
+		return std::sqrt(dx * dx + dz * dz) <= reach;
+	}
+
+	/**
+	 * Everything the hit tests need from a drone, computed once per query
+	 */
+	struct DroneProbe {
+		glm::vec3 pos;
+
+		// Half sizes of the drone, @a ryTarget includes the carried target
+		float rxz;
+		float ry;
+		float ryTarget;
+
+		bool hasTarget;
+	};
+
+	DroneProbe makeDroneProbe(const Drone &drone);
+
+	/**
+	 * Scalar reference of the hit tests, see obstacleKernels.h for the batched ones
+	 */
+	bool obstacleHit(const ObstacleDesc &o, const DroneProbe &probe);
+
+	inline bool obstacleHit(const ObstacleDesc &o, const Drone &drone)
+	{
+		return obstacleHit(o, makeDroneProbe(drone));
+	}
+
+	/**
+	 * Outward normal of the side of @a o that the probed drone touches,
+	 * for a drone right outside of it
+	 */
+	glm::vec3 obstacleNormal(const ObstacleDesc &o, const DroneProbe &probe);
+
+	inline ObstacleId makeObstacleId(ObstacleKind kind, uint32_t index)
+	{
+		return (static_cast<uint32_t>(kind) << OBSTACLE_INDEX_BITS) | index;
+	}
+	inline ObstacleKind obstacleKind(ObstacleId id)
+	{
+		return static_cast<ObstacleKind>(id >> OBSTACLE_INDEX_BITS);
+	}
+	inline uint32_t obstacleIndex(ObstacleId id)
+	{
+		return id & OBSTACLE_INDEX_MASK;
+	}
+
+	/**
+	 * All the obstacles of a world, one structure of arrays per kind
+	 * Obstacles keep the order in which they were added
+	 */
+	class ObstacleStore {
+	public:
+		ObstacleStore() {}
+
+		void clear();
+		ObstacleId add(const ObstacleDesc &o);
+
+		inline ObstacleDesc get(ObstacleId id) const
+		{
+			ObstacleKind kind = obstacleKind(id);
+			const Columns &c = columns[kind];
+			uint32_t i = obstacleIndex(id);
+
+			return { kind, c.x[i], c.z[i], c.size[i], c.h[i] };
+		}
+
+		inline size_t size(ObstacleKind kind) const
+		{
+			return columns[kind].x.size();
+		}
+
+		/**
+		 * Bytes held by the columns
+		 */
+		size_t memoryUsage() const;
+
+		inline bool hit(ObstacleId id, const Drone &drone) const
+		{
+			return obstacleHit(get(id), drone);
+		}
+
+		/**
+		 * True if the probed drone hits any of the obstacles of @a kind
+		 * at @a indices, tested HIT_BATCH at a time
+		 */
+		bool anyHit(ObstacleKind kind, const uint32_t *indices, size_t count,
+			const DroneProbe &probe) const;
+
+	private:
+		struct Columns {
+			std::vector<float> x;
+			std::vector<float> z;
+			std::vector<float> size;
+			std::vector<float> h;
+		};
+
+		Columns columns[NR_OBSTACLE_KINDS];
+	};
+
+} // namespace obj3D
@@ -1,89 +1,136 @@
 #include "terrain.h"
+#include "obstacleKernels.h"
 
 #include <random>
-#include <set>
-#include <memory>
-
-#include "core/gpu/shader.h"
-#include "core/engine.h"
-
-#include "../../objects.h"
-#include "../../../color.h"
+#include <algorithm>
 
 using namespace obj3D;
 
-void Terrain::generateTiles()
+void Terrain::bakeHeights(ThreadPool *pool)
 {
-	for (float dx = -sizeX / 2.f; dx <= sizeX / 2.f; dx++) {
-		for (float dz = -sizeZ / 2.f; dz <= sizeZ / 2.f; dz++) {
-			auto modelMatrix = glm::mat4(1);
-			modelMatrix = glm::translate(modelMatrix, glm::vec3(dx, 0, dz));
-			modelMatrix = glm::scale(modelMatrix, glm::vec3(0.5f, 1, 1));
-
-			tileMatrices.push_back(modelMatrix);
-		}
-	}
+	// The lattice covers all the tiles of the chunks, and a bit more for pages
+	int margin = paged ? TERRAIN_PAGE_MARGIN : 0;
+
+	heights.bake(-sizeX / 2.f - margin, -sizeZ / 2.f - margin,
+		sizeX + 1 + 2 * margin, sizeZ + 1 + 2 * margin, latticeResolution,
+		[this](float x, float z) {
+			return getNoise(x, z);
+		}, pool);
 }
 
-float obj3D::distance(const Point &p1, const Point &p2)
+void Terrain::generateChunks(ThreadPool *pool)
 {
-	float dx = abs(p1.first - p2.first);
-	float dy = abs(p1.second - p2.second);
+	// Same area as the unit tiles used to cover, starting from the lower corner
+	float x0 = -sizeX / 2.f;
+	float z0 = -sizeZ / 2.f;
 
-	return sqrt(dx * dx + dy * dy);
-}
+	int tilesX = sizeX + 1;
+	int tilesZ = sizeZ + 1;
 
-bool Tree::intersectTree(const Obstacle &o) const
-{
-	auto t = dynamic_cast<const Tree *>(&o);
-	if (t != nullptr) {
-		return distance(pos, t->pos) <= r + t->r + 0.1f;
-	}
-	throw std::exception();
+	auto noiseAt = [this](float x, float z) {
+		return heights.sample(x, z);
+	};
+
+	int nrChunksX = (tilesX + TERRAIN_CHUNK_SIZE - 1) / TERRAIN_CHUNK_SIZE;
+	int nrChunksZ = (tilesZ + TERRAIN_CHUNK_SIZE - 1) / TERRAIN_CHUNK_SIZE;
+
+	// Row by row, every chunk in its own slot
+	chunks.resize(nrChunksX * nrChunksZ);
+
+	auto buildChunk = [&](size_t idx) {
+		int i = static_cast<int>(idx % nrChunksX) * TERRAIN_CHUNK_SIZE;
+		int j = static_cast<int>(idx / nrChunksX) * TERRAIN_CHUNK_SIZE;
+
+		chunks[idx].build(x0 + i, z0 + j, std::min(TERRAIN_CHUNK_SIZE, tilesX - i),
+			std::min(TERRAIN_CHUNK_SIZE, tilesZ - j), TERRAIN_MAX_Y, noiseAt);
+	};
+
+	parallelFor(pool, chunks.size(), buildChunk);
 }
 
-bool Tree::intersectBuilding(const Obstacle &o) const
+float obj3D::distance(const Point &p1, const Point &p2)
 {
-	auto b = dynamic_cast<const Building *>(&o);
-	if (b != nullptr) {
-		return distance(pos, b->pos) <= r + b->l / 3.f + 0.1f;
-	}
-	throw std::exception();
+	float dx = std::abs(p1.first - p2.first);
+	float dy = std::abs(p1.second - p2.second);
+
+	return std::sqrt(dx * dx + dy * dy);
 }
 
-bool Building::intersectTree(const Obstacle &o) const
+bool Terrain::checkPosition(const ObstacleDesc &o) const
 {
-	auto t = dynamic_cast<const Tree *>(&o);
-	if (t != nullptr) {
-		return distance(pos, t->pos) <= l / 3.f + t->r + 0.1f;
-	}
-	throw std::exception();
+	float reach = obstacleFootprint(o) + maxFootprint + 0.1f;
+
+	return !grid.any(o.x - reach, o.z - reach, o.x + reach, o.z + reach, [this, &o](ObstacleId other) {
+		return obstaclesIntersect(o, obstacles.get(other));
+	});
 }
 
-bool Building::intersectBuilding(const Obstacle &o) const
+bool Terrain::hit(const Drone &drone) const
 {
-	auto b = dynamic_cast<const Building *>(&o);
-	if (b != nullptr) {
-		return distance(pos, b->pos) <= (l + b->l) / 3.f + 0.1f;
+	DroneProbe probe = makeDroneProbe(drone);
+
+	uint32_t batches[NR_OBSTACLE_KINDS][HIT_BATCH];
+	size_t batchSizes[NR_OBSTACLE_KINDS] = {};
+
+	bool found = grid.any(probe.pos.x - probe.rxz, probe.pos.z - probe.rxz,
+		probe.pos.x + probe.rxz, probe.pos.z + probe.rxz, [&](ObstacleId id) {
+			ObstacleKind kind = obstacleKind(id);
+			batches[kind][batchSizes[kind]++] = obstacleIndex(id);
+
+			if (batchSizes[kind] < HIT_BATCH) {
+				return false;
+			}
+
+			batchSizes[kind] = 0;
+			return obstacles.anyHit(kind, batches[kind], HIT_BATCH, probe);
+		});
+
+	for (int kind = 0; kind < NR_OBSTACLE_KINDS && !found; kind++) {
+		found = obstacles.anyHit(static_cast<ObstacleKind>(kind), batches[kind], batchSizes[kind], probe);
 	}
-	throw std::exception();
+
+	return found;
 }
 
-bool checkPosition(const Obstacle &o, const ObstacleSet &obstacles)
+void Terrain::addObstacle(const ObstacleDesc &o, const glm::mat4 &modelMatrix)
 {
-	if (obstacles.empty()) {
-		return true;
-	}
+	float extent = obstacleExtent(o);
 
-	auto it = std::min_element(obstacles.begin(), obstacles.end(),
-		[&o](const ObstaclePtr &a, const ObstaclePtr &b) {
-			return distance(a->pos, o.pos) < distance(b->pos, o.pos);
-		});
-	return !o.intersect(**it);
+	grid.insert(obstacles.add(o), o.x, o.z, extent);
+	maxFootprint = std::max(maxFootprint, obstacleFootprint(o));
+
+	// The crown of a tree goes above its trunk
+	float top = (o.kind == OBSTACLE_TREE) ? TREE_TOP * o.h : o.h;
+
+	auto &group = obstacleGroups[o.kind];
+	group.matrices.push_back(modelMatrix);
+	group.boxes.push_back(AABB(glm::vec3(o.x - extent, 0, o.z - extent),
+		glm::vec3(o.x + extent, top, o.z + extent)));
 }
 
-void Terrain::generateObstacles(int nrObstacles)
+typedef std::pair<ObstacleDesc, glm::mat4> ObstacleSample;
+
+/**
+ * Bridson's Poisson-disk sampling, with per-obstacle radii
+ * New obstacles are only looked for around the already placed ones, in the
+ * annulus [d, 2d] where @a d is the minimum distance between the two
+ *
+ * The map is split into square regions, each sampled with a generator of
+ * its own. A region is at least as wide as the furthest two obstacles
+ * can interact, so regions two apart never conflict: the regions are
+ * filled in four phases of a 2 x 2 pattern, all the regions of a phase
+ * in parallel. A region grows from the obstacles the earlier phases put
+ * next to it, only the ones inside it are kept. None of this depends on
+ * the number of threads, so the world only depends on the seed
+ *
+ * The result is then thinned out to @a nrObstacles
+ */
+void Terrain::generateObstacles(int nrObstacles, std::mt19937 &gen, ThreadPool *pool)
 {
+	if (nrObstacles <= 0) {
+		return;
+	}
+
 	Drone mock;
 	mock.size = DRONE_SIZE;
 	mock.pos = glm::vec3(0, 5, 0);
@@ -95,224 +142,349 @@ void Terrain::generateObstacles(int nrObstacles)
 	float maxRY = 2.75f * baseScale / 2.f;
 	float maxRXZ = maxRY * 3.f / 5.f;
 
-	std::random_device rd;
-	std::mt19937 gen(rd());
+	float border = std::max(maxRXZ / 2.f, borderMargin);
 
-	std::uniform_real_distribution<> distX(-rangeX + maxRXZ / 2.f, rangeX - maxRXZ / 2.f);
-	std::uniform_real_distribution<> distZ(-rangeZ + maxRXZ / 2.f, rangeZ - maxRXZ / 2.f);
-	std::uniform_real_distribution<> distScale(2.f, 5.f);
+	float minX = -rangeX + border, maxX = rangeX - border;
+	float minZ = -rangeZ + border, maxZ = rangeZ - border;
 
-	int fail = 0;
+	// Chosen so that the sampled set is slightly larger than requested
+	float spacing = 0.65f * std::sqrt(sizeX * sizeZ / static_cast<float>(nrObstacles));
 
-	for (int i = 0; i < nrObstacles; i++) {
-		if (fail > 50) {
-			fail = 0;
-			continue;
-		}
+	// A tree at the largest scale
+	float maxSampleFootprint = 5.f * baseScale * 3.f / 10.f;
+	float regionSize = std::max({ OBSTACLE_REGION_SIZE, spacing, 2.f * maxSampleFootprint + 0.1f });
+
+	int nrRegionsX = std::max(1, static_cast<int>(std::ceil((maxX - minX) / regionSize)));
+	int nrRegionsZ = std::max(1, static_cast<int>(std::ceil((maxZ - minZ) / regionSize)));
+
+	std::vector<std::vector<ObstacleSample>> regions(nrRegionsX * nrRegionsZ);
 
-		float scaleY = distScale(gen) * baseScale;
+	auto regionX = [&](float x) {
+		return std::max(0, std::min(nrRegionsX - 1, static_cast<int>(std::floor((x - minX) / regionSize))));
+	};
+	auto regionZ = [&](float z) {
+		return std::max(0, std::min(nrRegionsZ - 1, static_cast<int>(std::floor((z - minZ) / regionSize))));
+	};
+
+	auto makeSample = [](const Point &pos, bool isBuilding, float scaleY) {
 		float scaleXZ = scaleY * 3.f / 5.f;
 
-		Point pos(distX(gen), distZ(gen));
-		std::string name;
+		ObstacleDesc o;
+		auto modelMatrix = glm::mat4(1);
+
+		if (isBuilding) {
+			o = { OBSTACLE_BUILDING, pos.first, pos.second, scaleXZ, scaleY };
+			modelMatrix = glm::translate(modelMatrix, glm::vec3(0, scaleY / 2.f, 0));
+		} else {
+			o = { OBSTACLE_TREE, pos.first, pos.second, scaleXZ * 0.5f, scaleY };
+		}
+
+		modelMatrix = glm::translate(modelMatrix, glm::vec3(pos.first, 0, pos.second));
+		modelMatrix = glm::scale(modelMatrix, glm::vec3(scaleXZ, scaleY, scaleXZ));
+
+		return std::make_pair(o, modelMatrix);
+	};
+
+	auto fillRegion = [&](int rx, int rz) {
+		std::seed_seq regionSeed = { seed, static_cast<unsigned int>(rz * nrRegionsX + rx) };
+		std::mt19937 regionGen(regionSeed);
+
+		float x0 = minX + rx * regionSize;
+		float z0 = minZ + rz * regionSize;
+
+		std::uniform_real_distribution<> distX(x0, std::min(maxX, x0 + regionSize));
+		std::uniform_real_distribution<> distZ(z0, std::min(maxZ, z0 + regionSize));
+		std::uniform_real_distribution<> distScale(2.f, 5.f);
+		std::uniform_real_distribution<> distUnit(0.f, 1.f);
+
+		std::vector<ObstacleSample> &own = regions[rz * nrRegionsX + rx];
 
-		if (i % 6 == 0) {
-			name = "Building";
+		// Everything this region can conflict with, its own samples included
+		std::vector<const std::vector<ObstacleSample> *> near;
+		std::vector<ObstacleDesc> active;
 
-			Building building(pos, scaleY, scaleXZ);
-			if (building.hit(mock) || !checkPosition(building, obstacles)) {
-				fail++;
-				i--;
-				continue;
+		for (int z = std::max(0, rz - 1); z <= std::min(nrRegionsZ - 1, rz + 1); z++) {
+			for (int x = std::max(0, rx - 1); x <= std::min(nrRegionsX - 1, rx + 1); x++) {
+				auto &region = regions[z * nrRegionsX + x];
+				near.push_back(&region);
+
+				if (&region != &own) {
+					for (auto &&sample : region) {
+						active.push_back(sample.first);
+					}
+				}
 			}
+		}
 
-			fail = 0;
-			obstacles.insert(std::make_shared<Building>(building));
-		} else {
-			name = "Tree";
+		auto tryAdd = [&](const ObstacleSample &sample) {
+			const ObstacleDesc &o = sample.first;
 
-			float r = scaleXZ * 0.5f;
-			Tree tree(pos, r, scaleY);
+			if (o.x < minX || o.x > maxX || o.z < minZ || o.z > maxZ
+				|| regionX(o.x) != rx || regionZ(o.z) != rz || (keepSpawnFree && obstacleHit(o, mock))) {
+				return false;
+			}
 
-			if (tree.hit(mock) || !checkPosition(tree, obstacles)) {
-				fail++;
-				i--;
-				continue;
+			for (auto &&region : near) {
+				for (auto &&other : *region) {
+					const ObstacleDesc &s = other.first;
+					if (distance(Point(o.x, o.z), Point(s.x, s.z)) < spacing || obstaclesIntersect(o, s)) {
+						return false;
+					}
+				}
 			}
 
-			fail = 0;
-			obstacles.insert(std::make_shared<Tree>(tree));
+			own.push_back(sample);
+			active.push_back(o);
+
+			return true;
+		};
+
+		// One in six obstacles is a building
+		auto isBuilding = [&]() {
+			return distUnit(regionGen) < 1.f / 6.f;
+		};
+
+		// Nothing to grow from
+		for (int fail = 0; fail <= 50 && active.empty(); fail++) {
+			tryAdd(makeSample(Point(distX(regionGen), distZ(regionGen)),
+				isBuilding(), distScale(regionGen) * baseScale));
 		}
 
-		auto modelMatrix = glm::mat4(1);
-		if (i % 6 == 0) {
-			modelMatrix = glm::translate(modelMatrix, glm::vec3(0, scaleY / 2.f, 0));
+		while (!active.empty()) {
+			std::uniform_int_distribution<size_t> distActive(0, active.size() - 1);
+			size_t idx = distActive(regionGen);
+
+			ObstacleDesc centerSample = active[idx];
+			Point center(centerSample.x, centerSample.z);
+			float centerFootprint = obstacleFootprint(centerSample);
+
+			bool found = false;
+			for (int k = 0; k < POISSON_CANDIDATES && !found; k++) {
+				bool building = isBuilding();
+				float scaleY = distScale(regionGen) * baseScale;
+				float footprint = building ? scaleY / 5.f : scaleY * 3.f / 10.f;
+
+				float d = std::max(spacing, centerFootprint + footprint + 0.1f);
+				float radius = d * (1.f + distUnit(regionGen));
+				float angle = 2.f * glm::pi<float>() * distUnit(regionGen);
+
+				Point pos(center.first + radius * std::cos(angle), center.second + radius * std::sin(angle));
+				found = tryAdd(makeSample(pos, building, scaleY));
+			}
+
+			if (!found) {
+				active[idx] = active.back();
+				active.pop_back();
+			}
 		}
-		modelMatrix = glm::translate(modelMatrix, glm::vec3(pos.first, 0, pos.second));
-		modelMatrix = glm::scale(modelMatrix, glm::vec3(scaleXZ, scaleY, scaleXZ));
+	};
+
+	for (int phase = 0; phase < 4; phase++) {
+		std::vector<std::pair<int, int>> batch;
+
+		for (int rz = phase / 2; rz < nrRegionsZ; rz += 2) {
+			for (int rx = phase % 2; rx < nrRegionsX; rx += 2) {
+				batch.push_back({ rx, rz });
+			}
+		}
+
+		parallelFor(pool, batch.size(), [&](size_t i) {
+			fillRegion(batch[i].first, batch[i].second);
+		});
+	}
+
+	std::vector<ObstacleSample> samples;
+	for (auto &&region : regions) {
+		samples.insert(samples.end(), region.begin(), region.end());
+	}
+
+	std::shuffle(samples.begin(), samples.end(), gen);
+	if (samples.size() > static_cast<size_t>(nrObstacles)) {
+		samples.resize(nrObstacles);
+	}
+
+	for (auto &&sample : samples) {
+		addObstacle(sample.first, sample.second);
+	}
+}
+
+size_t Terrain::memoryUsage() const
+{
+	size_t bytes = heights.memoryUsage() + grid.memoryUsage() + obstacles.memoryUsage() + bvh.memoryUsage();
+
+	bytes += chunks.capacity() * sizeof(TerrainChunk);
+	for (auto &&chunk : chunks) {
+		bytes += chunk.vertices.capacity() * sizeof(TerrainVertex) + chunk.indices.capacity() * sizeof(unsigned int);
+	}
+
+	for (auto &&group : obstacleGroups) {
+		bytes += group.matrices.capacity() * sizeof(glm::mat4) + group.boxes.capacity() * sizeof(AABB);
+	}
+
+	return bytes + staticItems.capacity() * sizeof(StaticItem);
+}
+
+void Terrain::buildBVH()
+{
+	std::vector<AABB> boxes;
 
-		obstacleData.push_back({ name, modelMatrix });
+	for (unsigned int i = 0; i < chunks.size(); i++) {
+		staticItems.push_back({ StaticItem::CHUNK, -1, i });
+		boxes.push_back(AABB(chunks[i].boxMin, chunks[i].boxMax));
 	}
+
+	for (int group = 0; group < static_cast<int>(obstacleGroups.size()); group++) {
+		auto &matrices = obstacleGroups[group].matrices;
+
+		for (unsigned int i = 0; i < matrices.size(); i++) {
+			staticItems.push_back({ StaticItem::OBSTACLE, group, i });
+			boxes.push_back(obstacleGroups[group].boxes[i]);
+		}
+	}
+
+	bvh.build(boxes);
 }
 
 void Terrain::generateTarget(float size)
+{
+	target = pickTarget(targetGen, size);
+}
+
+Target Terrain::pickTarget(std::mt19937 &gen, float size) const
 {
 	float rangeX = sizeX / 2.f;
 	float rangeZ = sizeZ / 2.f;
 
-	std::random_device rd;
-	std::mt19937 gen(rd());
-
 	float fact = 9.f / 10.f;
 
 	std::uniform_real_distribution<> distX(-rangeX * fact, rangeX * fact);
 	std::uniform_real_distribution<> distZ(-rangeZ * fact, rangeZ * fact);
 
-	target.size = size;
-	target.angle = 0;
+	Target res;
+	res.size = size;
+	res.angle = 0;
 
-	float h = target.size / 3.f;
+	float h = res.size / 3.f;
 
-	while (true) {
-		Point pos(distX(gen), distZ(gen));
-		Building mock(pos, target.size / 2.f, target.size * 3.f / 10.f);
+	// A crowded or tiny world may have no free spot, the last one tried is kept
+	Point pos;
+	for (int tries = 0; tries < TARGET_TRIES; tries++) {
+		pos = Point(distX(gen), distZ(gen));
+		ObstacleDesc mock = { OBSTACLE_BUILDING, pos.first, pos.second, res.size * 3.f / 10.f, res.size / 2.f };
 
-		if (checkPosition(mock, obstacles)) {
-			target.pos = glm::vec3(pos.first,
-				getTerrainY(pos.first, pos.second) + h, pos.second);
+		if (checkPosition(mock)) {
 			break;
 		}
 	}
+	res.pos = glm::vec3(pos.first, getTerrainY(pos.first, pos.second) + h, pos.second);
 
-	while (true) {
-		Point pos(distX(gen), distZ(gen));
-		Building mock(pos, target.size / 2.f, target.size * 3.f / 10.f);
+	for (int tries = 0; tries < TARGET_TRIES; tries++) {
+		pos = Point(distX(gen), distZ(gen));
+		ObstacleDesc mock = { OBSTACLE_BUILDING, pos.first, pos.second, res.size * 3.f / 10.f, res.size / 2.f };
 
 		auto posV3 = glm::vec3(pos.first, 0, pos.second);
 
-		if (checkPosition(mock, obstacles) && glm::distance(target.pos, posV3) >= 5) {
-			target.sendPos = glm::vec3(pos.first,
-				getTerrainY(pos.first, pos.second) + h, pos.second);
-			target.distance = glm::distance(target.pos, target.sendPos);
-			return;
+		if (checkPosition(mock) && glm::distance(res.pos, posV3) >= 5) {
+			break;
 		}
 	}
+	res.sendPos = glm::vec3(pos.first, getTerrainY(pos.first, pos.second) + h, pos.second);
+	res.distance = glm::distance(res.pos, res.sendPos);
+
+	return res;
 }
 
-void Terrain::generate(int nrTilesX, int nrTilesZ, int nrObstacles, Shader *shader)
+void Terrain::reset(int nrTilesX, int nrTilesZ, unsigned int seed)
 {
-	tileMatrices.clear();
-	obstacleData.clear();
+	chunks.clear();
+	heights.clear();
+	// One group per obstacle kind, in kind order
+	obstacleGroups.clear();
+	for (int kind = 0; kind < NR_OBSTACLE_KINDS; kind++) {
+		obstacleGroups.push_back({ static_cast<ObstacleKind>(kind), {}, {} });
+	}
+	staticItems.clear();
 	obstacles.clear();
+	maxFootprint = 0;
 
 	sizeX = nrTilesX;
 	sizeZ = nrTilesZ;
 
-	generateTiles();
-	generateObstacles(nrObstacles);
-	generateTarget();
-
-	if (shader != nullptr) {
-		creationTime = static_cast<float>(glfwGetTime());
+	paged = false;
+	pageX = 0;
+	pageZ = 0;
+	worldSeed = seed;
+	borderMargin = 0;
+	keepSpawnFree = true;
 
-		glUseProgram(shader->program);
+	this->seed = seed;
+	targetGen.seed(seed + 1);
 
-		auto loc = glGetUniformLocation(shader->program, "time");
-		glUniform1f(loc, creationTime);
+	// The noise only goes through sin(), keep it in a range where floats are exact
+	noiseSeed = static_cast<float>(seed % 100000u) / 100.f;
 
-		glUseProgram(0);
-	}
+	grid.init(-sizeX / 2.f, -sizeZ / 2.f, sizeX / 2.f, sizeZ / 2.f, OBSTACLE_GRID_CELL);
 }
 
-Mesh *Tree::createTree(const std::string &name, glm::vec3 corner, float h, float r)
+void Terrain::generate(int nrTilesX, int nrTilesZ, int nrObstacles, unsigned int seed,
+	ThreadPool *pool)
 {
-	Mesh *base = createCylinder("", corner, 4.f * h / 5.f, r / 5.f, COLOR_DARK_BROWN);
-	Mesh *leaf1 = createCone("", corner + glm::vec3(0, 2.f * h / 5.f, 0),
-		3.f * h / 5.f, r, COLOR_GREEN);
-	Mesh *leaf2 = createCone("", corner + glm::vec3(0, 4.f * h / 5.f, 0),
-		2.f * h / 5.f, r / 2.f, COLOR_GREEN);
+	reset(nrTilesX, nrTilesZ, seed);
 
-	auto tree = combineMeshes(name, { base, leaf1, leaf2 });
-	tree->SetDrawMode(GL_TRIANGLES);
+	std::mt19937 gen(seed);
 
-	return tree;
+	bakeHeights(pool);
+	generateChunks(pool);
+	generateObstacles(nrObstacles, gen, pool);
+	generateTarget();
+	firstTarget = target;
+
+	buildBVH();
 }
 
-bool coneHitDrone(glm::vec3 conePos, float coneR, float coneH,
-	glm::vec3 dronePos, float droneRXZ, float droneRY)
+/**
+ * SplitMix64 finalizer, spreads nearby integers over the whole range
+ */
+static inline unsigned long long mixBits(unsigned long long x)
 {
-	if (dronePos.y < conePos.y - droneRY
-		|| dronePos.y > conePos.y + coneH + droneRY / 2.f) {
-		return false;
-	}
-
-	float d = abs(dronePos.y - conePos.y);
-
-	float m = (0.05f - coneR) / coneH;
-	float n = coneR + 0.01f;
-
-	float r = abs(m * d + n);
-
-	return glm::distance(dronePos, glm::vec3(conePos.x, dronePos.y, conePos.z))
-		<= r + droneRXZ;
+	x += 0x9E3779B97F4A7C15ull;
+	x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+	x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+	return x ^ (x >> 31);
 }
 
-bool cylinderHitDrone(glm::vec3 cylPos, float cylR, float cylH,
-	glm::vec3 dronePos, float droneRXZ, float droneRY)
+static inline unsigned long long hashCell(long long x, long long z, unsigned int seed)
 {
-	if (dronePos.y < cylPos.y - droneRY
-		|| dronePos.y > cylPos.y + cylH + droneRY) {
-		return false;
-	}
-	return glm::distance(dronePos, glm::vec3(cylPos.x, dronePos.y, cylPos.z))
-		<= cylR + droneRXZ;
+	return mixBits(mixBits(mixBits(seed) ^ static_cast<unsigned long long>(x))
+		^ static_cast<unsigned long long>(z));
 }
 
-bool Building::hit(const Drone &drone) const
+void Terrain::generatePage(long long pageX, long long pageZ, int size, int nrObstacles,
+	unsigned int seed, ThreadPool *pool)
 {
-	float droneRXZ = drone.size * DRONE_L / 2.f;
-	float droneRY = drone.size * DRONE_h * 0.75f;
-
-	if (drone.pos.y > h + droneRY && drone.target != nullptr) {
-		droneRY += drone.target->size / 1.5f;
-	}
-	if (drone.pos.y > h + droneRY) {
-		return false;
-	}
+	size += size % 2;
 
-	float actualL = l / 4.f;
-	return abs(drone.pos.x - pos.first) <= actualL + droneRXZ
-		&& abs(drone.pos.z - pos.second) <= actualL + droneRXZ;
-}
+	// Every page samples its obstacles and targets with generators of its own
+	reset(size, size, static_cast<unsigned int>(hashCell(pageX, pageZ, ~seed)));
 
-bool Tree::hit(const Drone &drone) const
-{
-	float droneRXZ = drone.size * DRONE_L / 2.f;
-	float droneRY = drone.size * DRONE_h * 0.75f;
+	paged = true;
+	this->pageX = pageX;
+	this->pageZ = pageZ;
+	worldSeed = seed;
 
-	auto pos1 = pointAsVec3(pos) + glm::vec3(0, 2.f * h / 5.f, 0);
-	auto pos2 = pointAsVec3(pos) + glm::vec3(0, 4.f * h / 5.f, 0);
+	// A tree at the largest scale, obstacles of two pages can never touch
+	borderMargin = 3.f + 0.05f;
+	keepSpawnFree = (pageX == 0 && pageZ == 0);
 
-	if (drone.pos.y > pos1.y && drone.target != nullptr) {
-		float targetH = drone.target->size / 1.5f;
-		if (coneHitDrone(pos1, r, 3.f * h / 5.f, drone.pos, droneRXZ, droneRY + targetH)) {
-			return true;
-		}
-	} else if (coneHitDrone(pos1, r, 3.f * h / 5.f, drone.pos, droneRXZ, droneRY)) {
-		return true;
-	}
+	std::mt19937 gen(this->seed);
 
-	if (drone.pos.y > pos1.y && drone.target != nullptr) {
-		float targetH = drone.target->size / 1.5f;
-		if (coneHitDrone(pos2, r / 2.f, 2.f * h / 5.f, drone.pos, droneRXZ, droneRY + targetH)) {
-			return true;
-		}
-	} else if (coneHitDrone(pos2, r / 2.f, 2.f * h / 5.f, drone.pos, droneRXZ, droneRY)) {
-		return true;
-	}
+	bakeHeights(pool);
+	generateChunks(pool);
+	generateObstacles(nrObstacles, gen, pool);
+	generateTarget();
+	firstTarget = target;
 
-	auto pos3 = pointAsVec3(pos);
-	return cylinderHitDrone(pos3, r / 5.f, 4.f * h / 5.f, drone.pos, droneRXZ, droneRY);
+	buildBVH();
 }
 
 inline float random(glm::vec2 st)
@@ -343,8 +515,44 @@ float makeNoise(glm::vec2 coord, float time)
 		(d - b) * u.x * u.y;
 }
 
-inline float Terrain::getTerrainY(float x, float z) const
+/**
+ * Same value noise as makeNoise(), with the corners hashed from integer
+ * cells: exact however far the page is from the center of the world
+ */
+static float makePageNoise(long long cellX, long long cellZ, glm::vec2 f, unsigned int seed)
+{
+	auto corner = [seed](long long x, long long z) {
+		return static_cast<float>(hashCell(x, z, seed) >> 40) / static_cast<float>(1 << 24);
+	};
+
+	float a = corner(cellX, cellZ);
+	float b = corner(cellX + 1, cellZ);
+	float c = corner(cellX, cellZ + 1);
+	float d = corner(cellX + 1, cellZ + 1);
+
+	glm::vec2 u = f * f * (3.0f - 2.0f * f);
+
+	return glm::mix(a, b, u.x) +
+		(c - a) * u.y * (1.0f - u.x) +
+		(d - b) * u.x * u.y;
+}
+
+float Terrain::getNoise(float x, float z) const
+{
+	if (!paged) {
+		return makeNoise(glm::vec2(x, z) * 0.5f, noiseSeed);
+	}
+
+	// Pages are an even number of tiles wide, so their centers fall on cell corners
+	glm::vec2 coord = glm::vec2(x, z) * 0.5f;
+	glm::vec2 cell = glm::floor(coord);
+
+	return makePageNoise(pageX * (sizeX / 2) + static_cast<long long>(cell.x),
+		pageZ * (sizeZ / 2) + static_cast<long long>(cell.y), coord - cell, worldSeed);
+}
+
+float Terrain::getTerrainY(float x, float z) const
 {
-	float noise = makeNoise(glm::vec2(x, z) * 0.5f, creationTime);
+	float noise = heights.sample(x, z);
 	return glm::mix(0.f, TERRAIN_MAX_Y, 1.f - noise);
 }
@@ -1,19 +1,47 @@
 #pragma once
 
 #include <vector>
-#include <set>
-#include <memory>
-
-#include "core/gpu/mesh.h"
-#include "core/gpu/shader.h"
+#include <random>
+#include <string>
+#include <algorithm>
 
 #include "../drone/drone.h"
+#include "obstacleGrid.h"
+#include "obstacleStore.h"
+#include "terrainChunk.h"
+#include "heightLattice.h"
+#include "../../culling.h"
+#include "../../threadPool.h"
 
 #define TERRAIN_MAX_Y 0.5f
 
+// Terrain heights baked per unit, the terrain mesh has one vertex per unit
+#define TERRAIN_LATTICE_RESOLUTION 1
+
+// Gap kept between the bottom of the drone and the ground
+#define TERRAIN_CLEARANCE 0.05f
+
+// Bisection steps refining the time of impact of a sweep
+#define SWEEP_ITERATIONS 10
+
 #define BUILDING_h 1.f
 #define BUILDING_L 0.5f
 
+// Top of the upper crown of a tree, in heights of its trunk, see createTree()
+#define TREE_TOP 1.2f
+
+#define POISSON_CANDIDATES 30
+
+// Random spots tried for the pickup and the delivery of a target
+#define TARGET_TRIES 1000
+
+// Smallest side of the regions the obstacles are sampled in, in parallel
+#define OBSTACLE_REGION_SIZE 16.f
+
+// Units baked around a page of an endless world, so that short moves
+// across its border still read the right heights
+#define TERRAIN_PAGE_MARGIN 2
+
 typedef std::pair<float, float> Point;
 
 namespace obj3D {
@@ -24,123 +52,249 @@ namespace obj3D {
 		return glm::vec3(p.first, 0, p.second);
 	}
 
-	class Obstacle {
-	public:
-		Point pos;
-
-		Obstacle() {}
-		virtual ~Obstacle() = default;
-		Obstacle(const Point &pos) : pos(pos) {}
-
-		/**
-		 * !!! No 2 obstacles should have the same @a pos !!!
-		 */
-		inline bool operator<(const Obstacle &o) const
-		{
-			return pos < o.pos;
-		}
+	/**
+	 * Meshes of the obstacles, a unit sized instance is scaled by the model matrices
+	 */
+	Mesh *createTree(const std::string &name, glm::vec3 corner, float h, float r);
+	Mesh *createBuilding(const std::string &name, glm::vec3 center);
+
+	/**
+	 * Model matrices of the obstacles drawn with the same mesh
+	 */
+	struct ObstacleGroup {
+		ObstacleKind kind;
+		std::vector<glm::mat4> matrices;
+		std::vector<AABB> boxes;
+	};
 
-		virtual bool hit(const Drone &drone) const = 0;
-		virtual bool intersect(const Obstacle &o) const = 0;
+	typedef std::vector<ObstacleGroup> ObstacleGroups;
 
-		virtual bool intersectTree(const Obstacle &t) const = 0;
-		virtual bool intersectBuilding(const Obstacle &b) const = 0;
-	};
+	/**
+	 * Result of moving a drone along a displacement, see Terrain::sweep()
+	 */
+	struct SweepHit {
+		bool hit = false;
 
-	class Tree : public Obstacle {
-	public:
-		float r = 0;
-		float h = 0;
+		// Fraction of the displacement that can be travelled, 1 if nothing was hit
+		float toi = 1;
 
-		Tree() : Obstacle() {};
-		Tree(const Point &pos, float r, float h) : Obstacle(pos), r(r), h(h) {}
+		glm::vec3 normal = glm::vec3(0);
 
-		bool hit(const Drone &drone) const override;
-		inline bool intersect(const Obstacle &o) const override
-		{
-			return o.intersectTree(*this);
-		}
+		// What is left of the displacement after the impact, along the surface
+		glm::vec3 slide = glm::vec3(0);
+	};
 
-		static Mesh *createTree(const std::string &name, glm::vec3 corner, float h, float r);
+	/**
+	 * Something static that can be culled: a terrain chunk
+	 * or the @a index -th obstacle of @a group
+	 */
+	struct StaticItem {
+		enum Kind { CHUNK, OBSTACLE };
 
-		bool intersectTree(const Obstacle &t) const override;
-		bool intersectBuilding(const Obstacle &b) const override;
+		Kind kind;
+		int group;
+		unsigned int index;
 	};
 
-	class Building : public Obstacle {
+	class Terrain {
 	public:
-		float h = 1.f;
-		float l = 1.f;
+		Target target;
 
-		Building() : Obstacle() {};
-		Building(const Point &pos, float h, float l) : Obstacle(pos), h(h), l(l) {}
+		Terrain() {}
+
+		/**
+		 * The same @a seed always gives the same world and the same targets,
+		 * whether the work is spread over @a pool or not
+		 */
+		void generate(int nrTilesX, int nrTilesZ, int nrTrees, unsigned int seed,
+			ThreadPool *pool = nullptr);
+
+		/**
+		 * One page of an endless world: a square of @a size tiles (rounded
+		 * up to an even number) centered on (@a pageX, @a pageZ) * size.
+		 * Coordinates are relative to that center. Pages of the same
+		 * @a seed match at their borders and their obstacles stay inside
+		 * them, only page (0, 0) keeps the spawn point free
+		 */
+		void generatePage(long long pageX, long long pageZ, int size, int nrObstacles,
+			unsigned int seed, ThreadPool *pool = nullptr);
 
-		bool hit(const Drone &drone) const override;
-		inline bool intersect(const Obstacle &o) const override
+		inline bool isPage() const
 		{
-			return o.intersectBuilding(*this);
+			return paged;
 		}
-
-		inline static Mesh *createBuilding(const std::string &name, glm::vec3 center)
+		inline long long getPageX() const
 		{
-			return createRectangleParallelepiped(name, center, BUILDING_L, BUILDING_L, BUILDING_h, COLOR_DARK_GREY, 0);
+			return pageX;
 		}
-
-		bool intersectTree(const Obstacle &t) const override;
-		bool intersectBuilding(const Obstacle &b) const override;
-	};
-
-	struct ObstacleComp {
-		inline bool operator()(const std::shared_ptr<Obstacle> &lhs, const std::shared_ptr<Obstacle> &rhs) const
+		inline long long getPageZ() const
 		{
-			return lhs < rhs;
+			return pageZ;
 		}
-	};
 
-	typedef std::shared_ptr<Obstacle> ObstaclePtr;
-	typedef std::set<ObstaclePtr, ObstacleComp> ObstacleSet;
+		/**
+		 * Writes the world to a binary snapshot, see terrainSnapshot.h,
+		 * along with the ceiling and obstacle density it was made for
+		 */
+		bool save(const std::string &path, int maxY, int tilesPerObstacle) const;
 
-	typedef std::pair<std::string, glm::mat4> ObstacleData;
+		/**
+		 * Replaces the world with a snapshot written by save(). Returns
+		 * false, leaving the terrain untouched, if the file is not valid
+		 * or was made for another ceiling or obstacle density
+		 */
+		bool load(const std::string &path, int maxY, int tilesPerObstacle);
 
-	class Terrain {
-	public:
-		Target target;
+		inline unsigned int getSeed() const
+		{
+			return seed;
+		}
+		inline int getSizeX() const
+		{
+			return sizeX;
+		}
+		inline int getSizeZ() const
+		{
+			return sizeZ;
+		}
 
-		Terrain() {}
+		/**
+		 * Heights baked per unit by the next generate(), a loaded
+		 * world keeps the resolution it was saved with
+		 */
+		inline void setLatticeResolution(int resolution)
+		{
+			latticeResolution = std::max(1, resolution);
+		}
 
-		void generate(int nrTilesX, int nrTilesZ, int nrTrees, Shader *shader);
+		/**
+		 * Terrain noise in [0, 1] baked by generate(), 0 being the highest
+		 */
+		inline const HeightLattice &getHeights() const
+		{
+			return heights;
+		}
 
-		inline const std::vector<glm::mat4> &getTileMatrices() const
+		inline const std::vector<TerrainChunk> &getChunks() const
+		{
+			return chunks;
+		}
+		inline const ObstacleGroups &getObstacleGroups() const
+		{
+			return obstacleGroups;
+		}
+		inline const std::vector<StaticItem> &getStaticItems() const
 		{
-			return tileMatrices;
+			return staticItems;
 		}
-		inline const std::vector<ObstacleData> &getObstacleData() const
+
+		/**
+		 * Calls @a visit with every static item in @a frustum
+		 */
+		template <typename Visit>
+		inline void cull(const Frustum &frustum, Visit visit) const
 		{
-			return obstacleData;
+			bvh.query(frustum, [this, &visit](unsigned int idx) {
+				visit(staticItems[idx]);
+			});
 		}
 
-		inline bool hit(const Drone &drone) const
+		inline const ObstacleStore &getObstacles() const
 		{
-			return std::find_if(obstacles.begin(), obstacles.end(), [&drone](const ObstaclePtr &o) {
-				return o->hit(drone);
-				}) != obstacles.end();
+			return obstacles;
 		}
 
+		/**
+		 * Bytes held by everything generate() builds, the CPU copy of the
+		 * terrain mesh included
+		 */
+		size_t memoryUsage() const;
+
+		/**
+		 * Only the obstacles in the grid cells overlapped by the drone are
+		 * tested, in batches of the same kind
+		 */
+		bool hit(const Drone &drone) const;
+
+		/**
+		 * Moves the probed drone along @a dVec against the obstacles and
+		 * the ground, with a single grid query over the whole path.
+		 * The path is sampled finer than the thinnest obstacle, so that
+		 * nothing is skipped however fast the drone goes
+		 * Obstacles the drone already touches at the start are ignored,
+		 * so that it can always move out of them. Without @a withFloor
+		 * only the obstacles are tested
+		 */
+		SweepHit sweep(const DroneProbe &probe, glm::vec3 dVec, bool withFloor = true) const;
+
+		/**
+		 * Lowest height of the center of the probed drone at (@a x, @a z)
+		 */
+		float getFloorY(const DroneProbe &probe, float x, float z) const;
+
 		void generateTarget(float size = 0.3f);
+
+		/**
+		 * A target and its delivery point, drawn from @a gen. Does not
+		 * change the terrain, generateTarget() uses its own generator
+		 */
+		Target pickTarget(std::mt19937 &gen, float size = 0.3f) const;
+
+		/**
+		 * Returns true if @a o does not intersect any placed obstacle
+		 */
+		bool checkPosition(const ObstacleDesc &o) const;
+
+		/**
+		 * Bilinear read of the baked lattice, the same values the terrain mesh is built from
+		 */
 		float getTerrainY(float x, float z) const;
 
 	private:
-		std::vector<glm::mat4> tileMatrices;
-		std::vector<ObstacleData> obstacleData;
-		ObstacleSet obstacles;
+		std::vector<TerrainChunk> chunks;
+		ObstacleGroups obstacleGroups;
+
+		std::vector<StaticItem> staticItems;
+		BVH bvh;
+		ObstacleStore obstacles;
+		ObstacleGrid grid;
+
+		unsigned int seed = 0;
+
+		// Target picked by generate(), the one stored in snapshots
+		Target firstTarget;
+		float noiseSeed = 0;
 
-		float creationTime = 0;
+		HeightLattice heights;
+		int latticeResolution = TERRAIN_LATTICE_RESOLUTION;
+
+		// Only used for targets, so that a loaded world picks the same ones
+		std::mt19937 targetGen;
+		float maxFootprint = 0;
 
 		int sizeX = 0;
 		int sizeZ = 0;
 
-		void generateTiles();
-		void generateObstacles(int nrObstacles);
+		// Set by generatePage(), the noise then comes from the world coordinates
+		bool paged = false;
+		long long pageX = 0;
+		long long pageZ = 0;
+		unsigned int worldSeed = 0;
+
+		// Distance kept between the obstacles and the border
+		float borderMargin = 0;
+		bool keepSpawnFree = true;
+
+		void reset(int nrTilesX, int nrTilesZ, unsigned int seed);
+
+		void bakeHeights(ThreadPool *pool);
+		void generateChunks(ThreadPool *pool);
+		// Evaluated only to bake the lattice
+		float getNoise(float x, float z) const;
+		void generateObstacles(int nrObstacles, std::mt19937 &gen, ThreadPool *pool);
+		void addObstacle(const ObstacleDesc &o, const glm::mat4 &modelMatrix);
+
+		void buildBVH();
 	};
 
 } // namespace obj3D
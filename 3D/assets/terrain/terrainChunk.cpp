@@ -0,0 +1,118 @@
+#include "terrainChunk.h"
+
+#include <algorithm>
+
+using namespace obj3D;
+
+/**
+ * Rows (or columns) used by a level of detail: every @a stride-th one, plus the last
+ */
+static std::vector<int> lodSamples(int n, int stride)
+{
+	std::vector<int> res;
+
+	for (int i = 0; i < n; i += stride) {
+		res.push_back(i);
+	}
+	res.push_back(n);
+
+	return res;
+}
+
+void TerrainChunk::build(float x0, float z0, int nrX, int nrZ, float maxY,
+	const std::function<float(float, float)> &noiseAt)
+{
+	this->nrX = nrX;
+	this->nrZ = nrZ;
+
+	vertices.clear();
+	indices.clear();
+
+	boxMin = glm::vec3(x0, maxY, z0);
+	boxMax = glm::vec3(x0 + nrX, 0, z0 + nrZ);
+
+	for (int j = 0; j <= nrZ; j++) {
+		for (int i = 0; i <= nrX; i++) {
+			float x = x0 + i;
+			float z = z0 + j;
+
+			float noise = noiseAt(x, z);
+			float y = glm::mix(0.f, maxY, 1.f - noise);
+
+			vertices.push_back({ glm::vec3(x, y, z), noise });
+
+			boxMin.y = std::min(boxMin.y, y);
+			boxMax.y = std::max(boxMax.y, y);
+		}
+	}
+
+	// Skirt: a lowered copy of the border, rows first, then columns
+	auto addSkirt = [this, maxY](int i, int j) {
+		TerrainVertex v = vertices[j * (this->nrX + 1) + i];
+		v.pos.y -= maxY;
+		vertices.push_back(v);
+	};
+
+	for (int i = 0; i <= nrX; i++) {
+		addSkirt(i, 0);
+	}
+	for (int i = 0; i <= nrX; i++) {
+		addSkirt(i, nrZ);
+	}
+	for (int j = 0; j <= nrZ; j++) {
+		addSkirt(0, j);
+	}
+	for (int j = 0; j <= nrZ; j++) {
+		addSkirt(nrX, j);
+	}
+	boxMin.y -= maxY;
+
+	for (int level = 0; level < TERRAIN_LOD_LEVELS; level++) {
+		addLevel(level);
+	}
+}
+
+void TerrainChunk::addLevel(int level)
+{
+	int stride = 1 << level;
+
+	auto xs = lodSamples(nrX, stride);
+	auto zs = lodSamples(nrZ, stride);
+
+	auto grid = [this](int i, int j) {
+		return static_cast<unsigned int>(j * (nrX + 1) + i);
+	};
+
+	unsigned int skirtBase = (nrX + 1) * (nrZ + 1);
+	unsigned int skirtRows[2] = { skirtBase, skirtBase + (nrX + 1) };
+	unsigned int skirtCols[2] = { skirtBase + 2 * (nrX + 1), skirtBase + 2 * (nrX + 1) + (nrZ + 1) };
+
+	lodOffset[level] = static_cast<unsigned int>(indices.size());
+
+	auto addQuad = [this](unsigned int a, unsigned int b, unsigned int c, unsigned int d) {
+		indices.insert(indices.end(), { a, c, b, b, c, d });
+	};
+
+	for (size_t zi = 0; zi + 1 < zs.size(); zi++) {
+		for (size_t xi = 0; xi + 1 < xs.size(); xi++) {
+			addQuad(grid(xs[xi], zs[zi]), grid(xs[xi + 1], zs[zi]),
+				grid(xs[xi], zs[zi + 1]), grid(xs[xi + 1], zs[zi + 1]));
+		}
+	}
+
+	for (size_t xi = 0; xi + 1 < xs.size(); xi++) {
+		int a = xs[xi], b = xs[xi + 1];
+
+		addQuad(skirtRows[0] + a, skirtRows[0] + b, grid(a, 0), grid(b, 0));
+		addQuad(grid(a, nrZ), grid(b, nrZ), skirtRows[1] + a, skirtRows[1] + b);
+	}
+
+	for (size_t zi = 0; zi + 1 < zs.size(); zi++) {
+		int a = zs[zi], b = zs[zi + 1];
+
+		addQuad(skirtCols[0] + a, grid(0, a), skirtCols[0] + b, grid(0, b));
+		addQuad(grid(nrX, a), skirtCols[1] + a, grid(nrX, b), skirtCols[1] + b);
+	}
+
+	lodCount[level] = static_cast<unsigned int>(indices.size()) - lodOffset[level];
+}
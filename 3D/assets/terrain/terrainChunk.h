@@ -0,0 +1,56 @@
+#pragma once
+
+#include <vector>
+#include <functional>
+
+#include "utils/glm_utils.h"
+
+#define TERRAIN_CHUNK_SIZE 16
+#define TERRAIN_LOD_LEVELS 4
+
+namespace obj3D {
+
+	struct TerrainVertex {
+		glm::vec3 pos;
+		float noise;
+	};
+
+	/**
+	 * Square patch of the terrain with its heights baked in
+	 * All the levels of detail share the same vertices, level @a k only
+	 * uses every 2^k-th row and column. Every level has a skirt hanging
+	 * down from its border, hiding the cracks between neighbouring
+	 * chunks drawn at different levels
+	 */
+	class TerrainChunk {
+	public:
+		glm::vec3 boxMin;
+		glm::vec3 boxMax;
+
+		std::vector<TerrainVertex> vertices;
+		std::vector<unsigned int> indices;
+
+		// Index range of every level of detail, finest first
+		unsigned int lodOffset[TERRAIN_LOD_LEVELS] = {};
+		unsigned int lodCount[TERRAIN_LOD_LEVELS] = {};
+
+		/**
+		 * Builds the chunk of @a nrX x @a nrZ unit tiles starting at (@a x0, @a z0)
+		 * @a noiseAt gives the terrain noise in [0, 1] at a world position
+		 */
+		void build(float x0, float z0, int nrX, int nrZ, float maxY,
+			const std::function<float(float, float)> &noiseAt);
+
+		inline glm::vec3 center() const
+		{
+			return (boxMin + boxMax) / 2.f;
+		}
+
+	private:
+		int nrX = 0;
+		int nrZ = 0;
+
+		void addLevel(int level);
+	};
+
+} // namespace obj3D
@@ -0,0 +1,168 @@
+#include "terrainMesh.h"
+
+#include <cstddef>
+#include <cstdint>
+
+using namespace obj3D;
+
+TerrainMesh::~TerrainMesh()
+{
+	release();
+}
+
+void TerrainMesh::release()
+{
+	if (vao == 0) {
+		return;
+	}
+
+	glDeleteBuffers(1, &vbo);
+	glDeleteBuffers(1, &ibo);
+	glDeleteVertexArrays(1, &vao);
+
+	vao = vbo = ibo = 0;
+	ranges.clear();
+	pending = nullptr;
+}
+
+void TerrainMesh::upload(const std::vector<TerrainChunk> &chunks, RenderCounters *counters)
+{
+	beginUpload(chunks);
+	uploadStep(SIZE_MAX, counters);
+}
+
+void TerrainMesh::beginUpload(const std::vector<TerrainChunk> &chunks)
+{
+	release();
+
+	nrVertices = 0;
+	nrIndices = 0;
+
+	for (auto &&chunk : chunks) {
+		ChunkRange range;
+		range.boxMin = chunk.boxMin;
+		range.boxMax = chunk.boxMax;
+		range.baseVertex = static_cast<GLint>(nrVertices);
+		range.firstIndex = nrIndices;
+
+		for (int level = 0; level < TERRAIN_LOD_LEVELS; level++) {
+			range.lodOffset[level] = static_cast<unsigned int>(nrIndices) + chunk.lodOffset[level];
+			range.lodCount[level] = chunk.lodCount[level];
+		}
+
+		nrVertices += chunk.vertices.size();
+		nrIndices += chunk.indices.size();
+
+		ranges.push_back(range);
+	}
+
+	// Storage only, filled by uploadStep()
+	glGenVertexArrays(1, &vao);
+	glBindVertexArray(vao);
+
+	glGenBuffers(1, &vbo);
+	glBindBuffer(GL_ARRAY_BUFFER, vbo);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(TerrainVertex) * nrVertices, nullptr, GL_STATIC_DRAW);
+
+	glGenBuffers(1, &ibo);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(unsigned int) * nrIndices, nullptr, GL_STATIC_DRAW);
+
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(TerrainVertex),
+		reinterpret_cast<void *>(offsetof(TerrainVertex, pos)));
+	glEnableVertexAttribArray(1);
+	glVertexAttribPointer(1, 1, GL_FLOAT, GL_FALSE, sizeof(TerrainVertex),
+		reinterpret_cast<void *>(offsetof(TerrainVertex, noise)));
+
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	pending = &chunks;
+	nextChunk = 0;
+}
+
+bool TerrainMesh::uploadStep(size_t maxBytes, RenderCounters *counters)
+{
+	if (pending == nullptr) {
+		return vao != 0;
+	}
+
+	// Binding the index buffer as an element array would attach it to whatever vertex array is bound
+	glBindBuffer(GL_ARRAY_BUFFER, vbo);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, ibo);
+
+	// At least one chunk per step, so that the upload always ends
+	size_t sent = 0;
+	while (nextChunk < pending->size() && (sent == 0 || sent < maxBytes)) {
+		const TerrainChunk &chunk = (*pending)[nextChunk];
+		const ChunkRange &range = ranges[nextChunk];
+
+		size_t vertexBytes = sizeof(TerrainVertex) * chunk.vertices.size();
+		size_t indexBytes = sizeof(unsigned int) * chunk.indices.size();
+
+		glBufferSubData(GL_ARRAY_BUFFER, sizeof(TerrainVertex) * range.baseVertex,
+			vertexBytes, chunk.vertices.data());
+		glBufferSubData(GL_COPY_WRITE_BUFFER, sizeof(unsigned int) * range.firstIndex,
+			indexBytes, chunk.indices.data());
+
+		sent += vertexBytes + indexBytes;
+		nextChunk++;
+	}
+
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	if (counters != nullptr) {
+		counters->bufferBinds += 2;
+		counters->bytesUploaded += sent;
+	}
+
+	if (nextChunk == pending->size()) {
+		pending = nullptr;
+	}
+
+	return pending == nullptr;
+}
+
+int TerrainMesh::selectLevel(const glm::vec3 &boxMin, const glm::vec3 &boxMax, const glm::vec3 &eye)
+{
+	glm::vec3 closest = glm::clamp(eye, boxMin, boxMax);
+	float dist = glm::distance(eye, closest);
+
+	int level = 0;
+	for (float d = TERRAIN_LOD_DISTANCE; dist > d && level < TERRAIN_LOD_LEVELS - 1; d *= 2.f) {
+		level++;
+	}
+
+	return level;
+}
+
+void TerrainMesh::render(const glm::vec3 &eye, const std::vector<unsigned int> &visible,
+	RenderCounters *counters) const
+{
+	if (!isUploaded()) {
+		return;
+	}
+
+	glBindVertexArray(vao);
+
+	for (unsigned int idx : visible) {
+		const ChunkRange &range = ranges[idx];
+		int level = selectLevel(range.boxMin, range.boxMax, eye);
+
+		glDrawElementsBaseVertex(GL_TRIANGLES, range.lodCount[level], GL_UNSIGNED_INT,
+			reinterpret_cast<void *>(sizeof(unsigned int) * range.lodOffset[level]),
+			range.baseVertex);
+
+		if (counters != nullptr) {
+			counters->draw(range.lodCount[level] / 3);
+		}
+	}
+
+	glBindVertexArray(0);
+
+	if (counters != nullptr) {
+		counters->bufferBinds++;
+	}
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <vector>
+
+#include "core/gpu/mesh.h"
+
+#include "terrainChunk.h"
+#include "../../renderCounters.h"
+
+#define TERRAIN_LOD_DISTANCE 24.f
+
+namespace obj3D {
+
+	/**
+	 * GPU copy of the terrain chunks, all packed into one vertex and one index buffer
+	 */
+	class TerrainMesh {
+	public:
+		TerrainMesh() {}
+		~TerrainMesh();
+
+		TerrainMesh(const TerrainMesh &) = delete;
+		TerrainMesh &operator=(const TerrainMesh &) = delete;
+
+		/**
+		 * The GL calls of the uploads and of render() are added to @a counters, if given
+		 */
+		void upload(const std::vector<TerrainChunk> &chunks, RenderCounters *counters = nullptr);
+
+		/**
+		 * Same as upload(), with the data copied over the following
+		 * calls to uploadStep() so that no single frame stalls
+		 * @a chunks must stay alive and unchanged until then
+		 */
+		void beginUpload(const std::vector<TerrainChunk> &chunks);
+
+		/**
+		 * Copies whole chunks until about @a maxBytes were sent
+		 * Returns true once the whole terrain is on the GPU
+		 */
+		bool uploadStep(size_t maxBytes, RenderCounters *counters = nullptr);
+
+		inline bool isUploaded() const
+		{
+			return vao != 0 && pending == nullptr;
+		}
+
+		/**
+		 * One draw per chunk in @a visible, the level of detail
+		 * decreasing with the distance from @a eye
+		 */
+		void render(const glm::vec3 &eye, const std::vector<unsigned int> &visible,
+			RenderCounters *counters = nullptr) const;
+
+		/**
+		 * Frees the GPU buffers, nothing is drawn until the next upload
+		 */
+		void release();
+
+		static int selectLevel(const glm::vec3 &boxMin, const glm::vec3 &boxMax, const glm::vec3 &eye);
+
+	private:
+		struct ChunkRange {
+			glm::vec3 boxMin;
+			glm::vec3 boxMax;
+
+			GLint baseVertex;
+			size_t firstIndex;
+			unsigned int lodOffset[TERRAIN_LOD_LEVELS];
+			unsigned int lodCount[TERRAIN_LOD_LEVELS];
+		};
+
+		std::vector<ChunkRange> ranges;
+
+		// Chunks still to be copied by uploadStep()
+		const std::vector<TerrainChunk> *pending = nullptr;
+		size_t nextChunk = 0;
+		size_t nrVertices = 0;
+		size_t nrIndices = 0;
+
+		GLuint vao = 0;
+		GLuint vbo = 0;
+		GLuint ibo = 0;
+	};
+
+} // namespace obj3D
@@ -0,0 +1,346 @@
+#include "terrainSnapshot.h"
+#include "terrain.h"
+
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace obj3D;
+
+MappedFile::~MappedFile()
+{
+	close();
+}
+
+#ifdef _WIN32
+
+bool MappedFile::open(const std::string &path)
+{
+	close();
+
+	HANDLE f = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+		OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (f == INVALID_HANDLE_VALUE) {
+		return false;
+	}
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(f, &size) || size.QuadPart == 0) {
+		CloseHandle(f);
+		return false;
+	}
+
+	HANDLE m = CreateFileMappingA(f, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (m == nullptr) {
+		CloseHandle(f);
+		return false;
+	}
+
+	bytes = static_cast<const unsigned char *>(MapViewOfFile(m, FILE_MAP_READ, 0, 0, 0));
+	if (bytes == nullptr) {
+		CloseHandle(m);
+		CloseHandle(f);
+		return false;
+	}
+
+	file = f;
+	mapping = m;
+	length = static_cast<size_t>(size.QuadPart);
+
+	return true;
+}
+
+void MappedFile::close()
+{
+	if (bytes != nullptr) {
+		UnmapViewOfFile(bytes);
+		CloseHandle(mapping);
+		CloseHandle(file);
+	}
+
+	bytes = nullptr;
+	file = mapping = nullptr;
+	length = 0;
+}
+
+#else
+
+bool MappedFile::open(const std::string &path)
+{
+	close();
+
+	int fd = ::open(path.c_str(), O_RDONLY);
+	if (fd < 0) {
+		return false;
+	}
+
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size == 0) {
+		::close(fd);
+		return false;
+	}
+
+	void *addr = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+
+	// The mapping stays valid after the descriptor is closed
+	::close(fd);
+
+	if (addr == MAP_FAILED) {
+		return false;
+	}
+
+	bytes = static_cast<const unsigned char *>(addr);
+	length = static_cast<size_t>(st.st_size);
+
+	return true;
+}
+
+void MappedFile::close()
+{
+	if (bytes != nullptr) {
+		munmap(const_cast<unsigned char *>(bytes), length);
+	}
+
+	bytes = nullptr;
+	length = 0;
+}
+
+#endif
+
+/**
+ * Sections are aligned so that they can be read in place
+ */
+static uint64_t alignSection(uint64_t offset)
+{
+	return (offset + 15) & ~static_cast<uint64_t>(15);
+}
+
+template <typename T>
+static const T *section(const MappedFile &file, uint64_t offset, uint64_t count)
+{
+	if (offset % alignof(T) != 0 || offset > file.size()
+		|| count > (file.size() - offset) / sizeof(T)) {
+		return nullptr;
+	}
+	return reinterpret_cast<const T *>(file.data() + offset);
+}
+
+bool Terrain::save(const std::string &path, int maxY, int tilesPerObstacle) const
+{
+	SnapshotHeader header = {};
+
+	header.magic = SNAPSHOT_MAGIC;
+	header.version = SNAPSHOT_VERSION;
+	header.headerSize = sizeof(SnapshotHeader);
+
+	header.seed = seed;
+	header.sizeX = sizeX;
+	header.sizeZ = sizeZ;
+	header.maxY = maxY;
+	header.tilesPerObstacle = tilesPerObstacle;
+
+	std::vector<SnapshotChunk> chunkRecords;
+
+	for (auto &&chunk : chunks) {
+		SnapshotChunk record = {};
+
+		record.boxMin = chunk.boxMin;
+		record.boxMax = chunk.boxMax;
+		record.firstVertex = header.nrVertices;
+		record.nrVertices = static_cast<uint32_t>(chunk.vertices.size());
+		record.firstIndex = header.nrIndices;
+		record.nrIndices = static_cast<uint32_t>(chunk.indices.size());
+
+		for (int level = 0; level < TERRAIN_LOD_LEVELS; level++) {
+			record.lodOffset[level] = chunk.lodOffset[level];
+			record.lodCount[level] = chunk.lodCount[level];
+		}
+
+		header.nrVertices += record.nrVertices;
+		header.nrIndices += record.nrIndices;
+		chunkRecords.push_back(record);
+	}
+
+	std::vector<SnapshotObstacle> obstacleRecords;
+
+	for (auto &&group : obstacleGroups) {
+		for (size_t i = 0; i < group.matrices.size(); i++) {
+			SnapshotObstacle record = {};
+
+			record.matrix = group.matrices[i];
+			record.box = group.boxes[i];
+			record.kind = group.kind;
+
+			obstacleRecords.push_back(record);
+		}
+	}
+
+	header.nrChunks = static_cast<uint32_t>(chunkRecords.size());
+	header.nrObstacles = static_cast<uint32_t>(obstacleRecords.size());
+
+	header.chunksOffset = alignSection(sizeof(SnapshotHeader));
+	header.verticesOffset = alignSection(header.chunksOffset + sizeof(SnapshotChunk) * header.nrChunks);
+	header.indicesOffset = alignSection(header.verticesOffset + sizeof(TerrainVertex) * header.nrVertices);
+	header.obstaclesOffset = alignSection(header.indicesOffset + sizeof(unsigned int) * header.nrIndices);
+	header.latticeResolution = heights.getResolution();
+	header.nrHeights = static_cast<uint32_t>(heights.getValues().size());
+	header.heightsOffset = alignSection(header.obstaclesOffset + sizeof(SnapshotObstacle) * header.nrObstacles);
+	header.fileSize = header.heightsOffset + sizeof(float) * header.nrHeights;
+
+	header.targetPos = firstTarget.pos;
+	header.targetSendPos = firstTarget.sendPos;
+	header.targetSize = firstTarget.size;
+	header.targetDistance = firstTarget.distance;
+
+	std::vector<unsigned char> bytes(header.fileSize, 0);
+	std::memcpy(bytes.data(), &header, sizeof(header));
+	std::memcpy(bytes.data() + header.chunksOffset, chunkRecords.data(),
+		sizeof(SnapshotChunk) * chunkRecords.size());
+
+	unsigned char *vertexOut = bytes.data() + header.verticesOffset;
+	unsigned char *indexOut = bytes.data() + header.indicesOffset;
+
+	for (auto &&chunk : chunks) {
+		std::memcpy(vertexOut, chunk.vertices.data(), sizeof(TerrainVertex) * chunk.vertices.size());
+		std::memcpy(indexOut, chunk.indices.data(), sizeof(unsigned int) * chunk.indices.size());
+
+		vertexOut += sizeof(TerrainVertex) * chunk.vertices.size();
+		indexOut += sizeof(unsigned int) * chunk.indices.size();
+	}
+
+	std::memcpy(bytes.data() + header.obstaclesOffset, obstacleRecords.data(),
+		sizeof(SnapshotObstacle) * obstacleRecords.size());
+	std::memcpy(bytes.data() + header.heightsOffset, heights.getValues().data(),
+		sizeof(float) * header.nrHeights);
+
+	std::ofstream out(path, std::ios::binary | std::ios::trunc);
+	out.write(reinterpret_cast<const char *>(bytes.data()), bytes.size());
+
+	return static_cast<bool>(out);
+}
+
+bool Terrain::load(const std::string &path, int maxY, int tilesPerObstacle)
+{
+	MappedFile file;
+	if (!file.open(path) || file.size() < sizeof(SnapshotHeader)) {
+		return false;
+	}
+
+	auto header = section<SnapshotHeader>(file, 0, 1);
+	if (header->magic != SNAPSHOT_MAGIC || header->version != SNAPSHOT_VERSION
+		|| header->headerSize != sizeof(SnapshotHeader) || header->fileSize != file.size()) {
+		return false;
+	}
+
+	// Made for another game, the caller generates a new world instead
+	if (header->maxY != maxY || header->tilesPerObstacle != tilesPerObstacle) {
+		return false;
+	}
+
+	auto chunkRecords = section<SnapshotChunk>(file, header->chunksOffset, header->nrChunks);
+	auto vertices = section<TerrainVertex>(file, header->verticesOffset, header->nrVertices);
+	auto indices = section<unsigned int>(file, header->indicesOffset, header->nrIndices);
+	auto obstacleRecords = section<SnapshotObstacle>(file, header->obstaclesOffset, header->nrObstacles);
+	auto heightValues = section<float>(file, header->heightsOffset, header->nrHeights);
+
+	if (!chunkRecords || !vertices || !indices || !obstacleRecords || !heightValues) {
+		return false;
+	}
+
+	if (header->sizeX <= 0 || header->sizeZ <= 0 || header->latticeResolution <= 0
+		|| header->nrHeights != HeightLattice::nrValues(header->sizeX + 1,
+			header->sizeZ + 1, header->latticeResolution)) {
+		return false;
+	}
+
+	for (uint32_t i = 0; i < header->nrChunks; i++) {
+		auto &record = chunkRecords[i];
+		if (record.firstVertex > header->nrVertices
+			|| record.nrVertices > header->nrVertices - record.firstVertex
+			|| record.firstIndex > header->nrIndices
+			|| record.nrIndices > header->nrIndices - record.firstIndex) {
+			return false;
+		}
+
+		// Drawn straight from these, nothing may point past the chunk
+		for (int level = 0; level < TERRAIN_LOD_LEVELS; level++) {
+			if (record.lodOffset[level] > record.nrIndices
+				|| record.lodCount[level] > record.nrIndices - record.lodOffset[level]) {
+				return false;
+			}
+		}
+
+		for (uint32_t j = 0; j < record.nrIndices; j++) {
+			if (indices[record.firstIndex + j] >= record.nrVertices) {
+				return false;
+			}
+		}
+	}
+
+	for (uint32_t i = 0; i < header->nrObstacles; i++) {
+		if (obstacleRecords[i].kind >= NR_OBSTACLE_KINDS) {
+			return false;
+		}
+	}
+
+	reset(header->sizeX, header->sizeZ, header->seed);
+
+	// Targets are placed on the terrain, the heights have to be there first
+	heights.assign(-sizeX / 2.f, -sizeZ / 2.f, sizeX + 1, sizeZ + 1,
+		header->latticeResolution, heightValues);
+
+	chunks.resize(header->nrChunks);
+	for (uint32_t i = 0; i < header->nrChunks; i++) {
+		auto &record = chunkRecords[i];
+		auto &chunk = chunks[i];
+
+		chunk.boxMin = record.boxMin;
+		chunk.boxMax = record.boxMax;
+		chunk.vertices.assign(vertices + record.firstVertex,
+			vertices + record.firstVertex + record.nrVertices);
+		chunk.indices.assign(indices + record.firstIndex,
+			indices + record.firstIndex + record.nrIndices);
+
+		for (int level = 0; level < TERRAIN_LOD_LEVELS; level++) {
+			chunk.lodOffset[level] = record.lodOffset[level];
+			chunk.lodCount[level] = record.lodCount[level];
+		}
+	}
+
+	for (uint32_t i = 0; i < header->nrObstacles; i++) {
+		auto &record = obstacleRecords[i];
+
+		// Translation and scale only, as built by generateObstacles
+		Point pos(record.matrix[3][0], record.matrix[3][2]);
+		float scaleXZ = record.matrix[0][0];
+		float scaleY = record.matrix[1][1];
+
+		ObstacleDesc o;
+		if (record.kind == OBSTACLE_BUILDING) {
+			o = { OBSTACLE_BUILDING, pos.first, pos.second, scaleXZ, scaleY };
+		} else {
+			o = { OBSTACLE_TREE, pos.first, pos.second, scaleXZ * 0.5f, scaleY };
+		}
+		addObstacle(o, record.matrix);
+	}
+
+	// Replaying the first target puts the target generator where it was after generate()
+	generateTarget(header->targetSize);
+	target.pos = header->targetPos;
+	target.sendPos = header->targetSendPos;
+	target.distance = header->targetDistance;
+	firstTarget = target;
+
+	buildBVH();
+
+	return true;
+}
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+
+#include "terrainChunk.h"
+#include "../../culling.h"
+
+// "DGWS" read as a little endian integer
+#define SNAPSHOT_MAGIC 0x53574744u
+#define SNAPSHOT_VERSION 3u
+
+namespace obj3D {
+
+	/**
+	 * Binary world snapshot, laid out so that it can be used straight
+	 * from a memory mapping:
+	 *
+	 *   SnapshotHeader
+	 *   SnapshotChunk    [nrChunks]
+	 *   TerrainVertex    [nrVertices]
+	 *   unsigned int     [nrIndices]
+	 *   SnapshotObstacle [nrObstacles]
+	 *   float            [nrHeights]
+	 *
+	 * Every section starts at the offset stored in the header. The file
+	 * is only meant to be read back on the machine that wrote it
+	 */
+	struct SnapshotHeader {
+		uint32_t magic;
+		uint32_t version;
+		uint32_t headerSize;
+
+		uint32_t seed;
+		int32_t sizeX;
+		int32_t sizeZ;
+
+		// Settings of the game the world was made for, see Terrain::load()
+		int32_t maxY;
+		int32_t tilesPerObstacle;
+
+		uint32_t nrChunks;
+		uint32_t nrVertices;
+		uint32_t nrIndices;
+		uint32_t nrObstacles;
+
+		// Baked terrain lattice, see HeightLattice
+		int32_t latticeResolution;
+		uint32_t nrHeights;
+
+		uint64_t chunksOffset;
+		uint64_t verticesOffset;
+		uint64_t indicesOffset;
+		uint64_t obstaclesOffset;
+		uint64_t heightsOffset;
+		uint64_t fileSize;
+
+		// Target at the time of saving
+		glm::vec3 targetPos;
+		glm::vec3 targetSendPos;
+		float targetSize;
+		float targetDistance;
+	};
+
+	struct SnapshotChunk {
+		glm::vec3 boxMin;
+		glm::vec3 boxMax;
+
+		uint32_t firstVertex;
+		uint32_t nrVertices;
+		uint32_t firstIndex;
+		uint32_t nrIndices;
+
+		uint32_t lodOffset[TERRAIN_LOD_LEVELS];
+		uint32_t lodCount[TERRAIN_LOD_LEVELS];
+	};
+
+	struct SnapshotObstacle {
+		// ObstacleKind, widened so that the matrix stays aligned
+		uint32_t kind;
+
+		// Position and scale of the obstacle are read back from its model matrix
+		glm::mat4 matrix;
+		AABB box;
+	};
+
+	/**
+	 * Read-only view of a whole file, mapped into memory
+	 */
+	class MappedFile {
+	public:
+		MappedFile() {}
+		~MappedFile();
+
+		MappedFile(const MappedFile &) = delete;
+		MappedFile &operator=(const MappedFile &) = delete;
+
+		bool open(const std::string &path);
+		void close();
+
+		inline const unsigned char *data() const
+		{
+			return bytes;
+		}
+		inline size_t size() const
+		{
+			return length;
+		}
+
+	private:
+		const unsigned char *bytes = nullptr;
+		size_t length = 0;
+
+#ifdef _WIN32
+		void *file = nullptr;
+		void *mapping = nullptr;
+#endif
+	};
+
+} // namespace obj3D
@@ -0,0 +1,147 @@
+#include "terrain.h"
+
+#include <cmath>
+#include <vector>
+#include <algorithm>
+
+using namespace obj3D;
+
+float Terrain::getFloorY(const DroneProbe &probe, float x, float z) const
+{
+	float droneRY = probe.hasTarget ? probe.ryTarget : probe.ry;
+	return getTerrainY(x, z) + droneRY + TERRAIN_CLEARANCE;
+}
+
+namespace {
+
+	/**
+	 * Obstacles that can be met along one sweep, by kind
+	 */
+	struct SweepCandidates {
+		std::vector<uint32_t> indices[NR_OBSTACLE_KINDS];
+		bool floor = true;
+	};
+
+}
+
+static bool sweepBlocked(const Terrain &terrain, const SweepCandidates &candidates,
+	const DroneProbe &probe)
+{
+	if (candidates.floor && probe.pos.y < terrain.getFloorY(probe, probe.pos.x, probe.pos.z)) {
+		return true;
+	}
+
+	for (int kind = 0; kind < NR_OBSTACLE_KINDS; kind++) {
+		const std::vector<uint32_t> &indices = candidates.indices[kind];
+
+		if (terrain.getObstacles().anyHit(static_cast<ObstacleKind>(kind),
+			indices.data(), indices.size(), probe)) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+static glm::vec3 floorNormal(const Terrain &terrain, float x, float z)
+{
+	float eps = 0.01f;
+
+	float dydx = (terrain.getTerrainY(x + eps, z) - terrain.getTerrainY(x - eps, z)) / (2.f * eps);
+	float dydz = (terrain.getTerrainY(x, z + eps) - terrain.getTerrainY(x, z - eps)) / (2.f * eps);
+
+	return glm::normalize(glm::vec3(-dydx, 1, -dydz));
+}
+
+SweepHit Terrain::sweep(const DroneProbe &probe, glm::vec3 dVec, bool withFloor) const
+{
+	SweepHit res;
+
+	glm::vec3 from = probe.pos;
+	glm::vec3 to = from + dVec;
+
+	// Everything in the grid cells covered by the path
+	SweepCandidates candidates;
+	float reach = probe.rxz;
+
+	grid.any(std::min(from.x, to.x) - reach, std::min(from.z, to.z) - reach,
+		std::max(from.x, to.x) + reach, std::max(from.z, to.z) + reach, [&](ObstacleId id) {
+			if (!obstacleHit(obstacles.get(id), probe)) {
+				candidates.indices[obstacleKind(id)].push_back(obstacleIndex(id));
+			}
+			return false;
+		});
+
+	for (auto &&indices : candidates.indices) {
+		std::sort(indices.begin(), indices.end());
+		indices.erase(std::unique(indices.begin(), indices.end()), indices.end());
+	}
+
+	// Already below the ground, only keepInBounds() can lift it back
+	candidates.floor = withFloor && from.y >= getFloorY(probe, from.x, from.z);
+
+	// Every hit area is at least 2 * rxz wide and 2 * ry tall
+	float lengthXZ = std::sqrt(dVec.x * dVec.x + dVec.z * dVec.z);
+	float nrSteps = std::max(lengthXZ / probe.rxz, std::abs(dVec.y) / probe.ry);
+	int steps = std::max(1, static_cast<int>(std::ceil(nrSteps)));
+
+	DroneProbe moved = probe;
+	float tFree = 0;
+	float tHit = -1;
+
+	for (int i = 1; i <= steps; i++) {
+		float t = static_cast<float>(i) / steps;
+		moved.pos = from + dVec * t;
+
+		if (sweepBlocked(*this, candidates, moved)) {
+			tHit = t;
+			break;
+		}
+		tFree = t;
+	}
+
+	if (tHit < 0) {
+		return res;
+	}
+
+	for (int i = 0; i < SWEEP_ITERATIONS; i++) {
+		float t = (tFree + tHit) / 2.f;
+		moved.pos = from + dVec * t;
+
+		if (sweepBlocked(*this, candidates, moved)) {
+			tHit = t;
+		} else {
+			tFree = t;
+		}
+	}
+
+	res.hit = true;
+	res.toi = tFree;
+
+	// Whatever blocks the drone right after the impact gives the normal
+	glm::vec3 hitPos = from + dVec * tHit;
+	moved.pos = hitPos;
+
+	if (candidates.floor && hitPos.y < getFloorY(moved, hitPos.x, hitPos.z)) {
+		res.normal = floorNormal(*this, hitPos.x, hitPos.z);
+	} else {
+		for (int kind = 0; kind < NR_OBSTACLE_KINDS && res.normal == glm::vec3(0); kind++) {
+			for (uint32_t index : candidates.indices[kind]) {
+				ObstacleDesc o = obstacles.get(makeObstacleId(static_cast<ObstacleKind>(kind), index));
+
+				if (obstacleHit(o, moved)) {
+					moved.pos = from + dVec * tFree;
+					res.normal = obstacleNormal(o, moved);
+					break;
+				}
+			}
+		}
+	}
+
+	// The part of the rest of the path going into the surface is dropped
+	glm::vec3 rest = dVec * (1.f - tFree);
+	float into = glm::dot(rest, res.normal);
+	res.slide = (into < 0) ? rest - into * res.normal : rest;
+
+	return res;
+}
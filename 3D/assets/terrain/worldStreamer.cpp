@@ -0,0 +1,351 @@
+#include "worldStreamer.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+#include <algorithm>
+
+using namespace obj3D;
+
+WorldStreamer::~WorldStreamer()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	wake.notify_all();
+
+	if (worker.joinable()) {
+		worker.join();
+	}
+}
+
+void WorldStreamer::start(unsigned int seed)
+{
+	if (!worker.joinable()) {
+		pool.reset(new ThreadPool());
+		worker = std::thread(&WorldStreamer::work, this);
+	}
+
+	drain();
+
+	// The terrains are kept, their buffers are reused by the next pages
+	for (auto &&slot : slots) {
+		if (slot.terrain == nullptr) {
+			slot.terrain.reset(new Terrain());
+		}
+		slot.state = PAGE_FREE;
+		slot.lastUsed = 0;
+	}
+
+	this->seed = seed;
+	originX = 0;
+	originZ = 0;
+	tick = 0;
+	generated = 0;
+}
+
+/**
+ * Forgets the queued pages and waits for the one being generated
+ */
+void WorldStreamer::drain()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+
+	for (int idx : queue) {
+		slots[idx].state = PAGE_FREE;
+	}
+	queue.clear();
+
+	done.wait(lock, [this]() { return !busy; });
+}
+
+void WorldStreamer::work()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+
+	while (true) {
+		wake.wait(lock, [this]() { return stopping || !queue.empty(); });
+		if (stopping) {
+			return;
+		}
+
+		Slot &slot = slots[queue.front()];
+		queue.pop_front();
+		busy = true;
+
+		long long x = slot.x;
+		long long z = slot.z;
+		unsigned int worldSeed = seed;
+
+		lock.unlock();
+
+		slot.state = PAGE_GENERATING;
+		slot.terrain->generatePage(x, z, STREAM_PAGE_SIZE, STREAM_PAGE_OBSTACLES, worldSeed, pool.get());
+
+		lock.lock();
+
+		slot.state.store(PAGE_READY, std::memory_order_release);
+		busy = false;
+		generated++;
+
+		done.notify_all();
+	}
+}
+
+long long WorldStreamer::pageOf(float v) const
+{
+	return static_cast<long long>(std::floor(v / STREAM_PAGE_SIZE + 0.5f));
+}
+
+glm::vec3 WorldStreamer::pageOffset(long long x, long long z) const
+{
+	return glm::vec3(static_cast<float>((x - originX) * STREAM_PAGE_SIZE), 0,
+		static_cast<float>((z - originZ) * STREAM_PAGE_SIZE));
+}
+
+int WorldStreamer::findSlot(long long x, long long z) const
+{
+	for (int i = 0; i < STREAM_POOL_SIZE; i++) {
+		const Slot &slot = slots[i];
+
+		if (slot.state != PAGE_FREE && slot.x == x && slot.z == z) {
+			return i;
+		}
+	}
+
+	return -1;
+}
+
+const Terrain *WorldStreamer::readyPage(long long x, long long z) const
+{
+	int idx = findSlot(x, z);
+	if (idx < 0 || slots[idx].state.load(std::memory_order_acquire) != PAGE_READY) {
+		return nullptr;
+	}
+
+	return slots[idx].terrain.get();
+}
+
+bool WorldStreamer::touch(long long x, long long z)
+{
+	int idx = findSlot(x, z);
+	if (idx >= 0) {
+		slots[idx].lastUsed = tick;
+		return true;
+	}
+
+	// A free slot, or the ready page unused for the longest
+	for (int i = 0; i < STREAM_POOL_SIZE; i++) {
+		const Slot &slot = slots[i];
+
+		if (slot.state == PAGE_FREE) {
+			idx = i;
+			break;
+		}
+
+		if (slot.state == PAGE_READY && slot.lastUsed < tick
+			&& (idx < 0 || slot.lastUsed < slots[idx].lastUsed)) {
+			idx = i;
+		}
+	}
+
+	if (idx < 0) {
+		return false;
+	}
+
+	Slot &slot = slots[idx];
+
+	std::lock_guard<std::mutex> lock(mutex);
+
+	slot.x = x;
+	slot.z = z;
+	slot.lastUsed = tick;
+	slot.version++;
+	slot.state = PAGE_QUEUED;
+
+	queue.push_back(idx);
+	wake.notify_one();
+
+	return true;
+}
+
+/**
+ * Pages already in the pool are marked first, so that none of them can be
+ * evicted to make room for another, then the missing ones are queued
+ * nearest first
+ */
+void WorldStreamer::requestAround(long long x, long long z)
+{
+	for (long long dz = -STREAM_RADIUS; dz <= STREAM_RADIUS; dz++) {
+		for (long long dx = -STREAM_RADIUS; dx <= STREAM_RADIUS; dx++) {
+			int idx = findSlot(x + dx, z + dz);
+			if (idx >= 0) {
+				slots[idx].lastUsed = tick;
+			}
+		}
+	}
+
+	for (long long ring = 0; ring <= STREAM_RADIUS; ring++) {
+		for (long long dz = -ring; dz <= ring; dz++) {
+			for (long long dx = -ring; dx <= ring; dx++) {
+				if (std::max(std::abs(dx), std::abs(dz)) == ring) {
+					touch(x + dx, z + dz);
+				}
+			}
+		}
+	}
+}
+
+glm::vec3 WorldStreamer::update(const glm::vec3 &pos)
+{
+	tick++;
+
+	long long px = pageOf(pos.x);
+	long long pz = pageOf(pos.z);
+
+	glm::vec3 shift(0);
+	if (px != 0 || pz != 0) {
+		shift = glm::vec3(static_cast<float>(px * STREAM_PAGE_SIZE), 0,
+			static_cast<float>(pz * STREAM_PAGE_SIZE));
+
+		originX += px;
+		originZ += pz;
+	}
+
+	while (true) {
+		unsigned long long before = generated;
+
+		requestAround(originX, originZ);
+
+		bool ready = true;
+		for (long long dz = -1; dz <= 1 && ready; dz++) {
+			for (long long dx = -1; dx <= 1 && ready; dx++) {
+				ready = readyPage(originX + dx, originZ + dz) != nullptr;
+			}
+		}
+
+		if (ready) {
+			return shift;
+		}
+
+		std::unique_lock<std::mutex> lock(mutex);
+		done.wait(lock, [this, before]() { return generated != before; });
+	}
+}
+
+bool WorldStreamer::hit(const Drone &drone) const
+{
+	DroneProbe probe = makeDroneProbe(drone);
+
+	for (long long z = pageOf(probe.pos.z - probe.rxz); z <= pageOf(probe.pos.z + probe.rxz); z++) {
+		for (long long x = pageOf(probe.pos.x - probe.rxz); x <= pageOf(probe.pos.x + probe.rxz); x++) {
+			const Terrain *page = readyPage(originX + x, originZ + z);
+			if (page == nullptr) {
+				continue;
+			}
+
+			Drone local = drone;
+			local.pos -= pageOffset(originX + x, originZ + z);
+
+			if (page->hit(local)) {
+				return true;
+			}
+		}
+	}
+
+	return false;
+}
+
+SweepHit WorldStreamer::sweep(const DroneProbe &probe, glm::vec3 dVec) const
+{
+	SweepHit res;
+
+	glm::vec3 from = probe.pos;
+	glm::vec3 to = from + dVec;
+	float reach = probe.rxz;
+
+	long long startX = pageOf(from.x);
+	long long startZ = pageOf(from.z);
+
+	for (long long z = pageOf(std::min(from.z, to.z) - reach); z <= pageOf(std::max(from.z, to.z) + reach); z++) {
+		for (long long x = pageOf(std::min(from.x, to.x) - reach); x <= pageOf(std::max(from.x, to.x) + reach); x++) {
+			const Terrain *page = readyPage(originX + x, originZ + z);
+			if (page == nullptr) {
+				continue;
+			}
+
+			DroneProbe local = probe;
+			local.pos -= pageOffset(originX + x, originZ + z);
+
+			SweepHit pageHit = page->sweep(local, dVec, x == startX && z == startZ);
+			if (pageHit.hit && (!res.hit || pageHit.toi < res.toi)) {
+				res = pageHit;
+			}
+		}
+	}
+
+	return res;
+}
+
+float WorldStreamer::getFloorY(const DroneProbe &probe, float x, float z) const
+{
+	long long px = originX + pageOf(x);
+	long long pz = originZ + pageOf(z);
+
+	const Terrain *page = readyPage(px, pz);
+	if (page == nullptr) {
+		return std::numeric_limits<float>::lowest();
+	}
+
+	glm::vec3 offset = pageOffset(px, pz);
+	return page->getFloorY(probe, x - offset.x, z - offset.z);
+}
+
+float WorldStreamer::getTerrainY(float x, float z) const
+{
+	long long px = originX + pageOf(x);
+	long long pz = originZ + pageOf(z);
+
+	const Terrain *page = readyPage(px, pz);
+	if (page == nullptr) {
+		return 0;
+	}
+
+	glm::vec3 offset = pageOffset(px, pz);
+	return page->getTerrainY(x - offset.x, z - offset.z);
+}
+
+Target WorldStreamer::pickTarget(const glm::vec3 &pos, std::mt19937 &gen) const
+{
+	long long px = originX + pageOf(pos.x);
+	long long pz = originZ + pageOf(pos.z);
+
+	Target res;
+
+	const Terrain *page = readyPage(px, pz);
+	if (page == nullptr) {
+		return res;
+	}
+
+	glm::vec3 offset = pageOffset(px, pz);
+
+	res = page->pickTarget(gen);
+	res.pos += offset;
+	res.sendPos += offset;
+
+	return res;
+}
+
+WorldStreamer::PageView WorldStreamer::getPage(int slot) const
+{
+	const Slot &s = slots[slot];
+
+	PageView view;
+	view.state = static_cast<PageState>(s.state.load(std::memory_order_acquire));
+	view.version = s.version;
+	view.terrain = (view.state == PAGE_READY) ? s.terrain.get() : nullptr;
+	view.offset = pageOffset(s.x, s.z);
+
+	return view;
+}
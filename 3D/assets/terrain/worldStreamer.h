@@ -0,0 +1,164 @@
+#pragma once
+
+#include <deque>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <random>
+#include <condition_variable>
+
+#include "terrain.h"
+
+// Tiles on the side of a page, even
+#define STREAM_PAGE_SIZE 64
+
+#define STREAM_PAGE_OBSTACLES (STREAM_PAGE_SIZE * STREAM_PAGE_SIZE / 40)
+
+// Pages kept around the one under the drone, in every direction
+#define STREAM_RADIUS 2
+
+// Pages held in memory, the ones around the drone and a few on their way out
+#define STREAM_POOL_SIZE 32
+
+namespace obj3D {
+
+	/**
+	 * Endless world made of Terrain pages, generated from the seed on a
+	 * worker thread as the drone gets close and recycled least recently
+	 * used first, so that memory does not grow with the distance flown
+	 *
+	 * Positions are relative to the center of the origin page, which
+	 * follows the drone (floating origin): coordinates stay small and
+	 * keep their precision however far it goes
+	 */
+	class WorldStreamer {
+	public:
+		enum PageState { PAGE_FREE, PAGE_QUEUED, PAGE_GENERATING, PAGE_READY };
+
+		WorldStreamer() {}
+		~WorldStreamer();
+
+		WorldStreamer(const WorldStreamer &) = delete;
+		WorldStreamer &operator=(const WorldStreamer &) = delete;
+
+		/**
+		 * Drops every page and starts over with the world of @a seed,
+		 * the origin back on page (0, 0)
+		 */
+		void start(unsigned int seed);
+
+		/**
+		 * Moves the origin to the page under @a pos if it left the origin
+		 * page, and asks for the pages around it. Returns the shift, to be
+		 * subtracted from every position kept by the caller
+		 * Only returns once the pages next to the drone are ready, so the
+		 * world seen by the simulation never depends on thread timing
+		 */
+		glm::vec3 update(const glm::vec3 &pos);
+
+		bool hit(const Drone &drone) const;
+
+		/**
+		 * Terrain::sweep() over the pages crossed by the path, the floor
+		 * is read from the page the drone starts in
+		 */
+		SweepHit sweep(const DroneProbe &probe, glm::vec3 dVec) const;
+
+		float getFloorY(const DroneProbe &probe, float x, float z) const;
+		float getTerrainY(float x, float z) const;
+
+		/**
+		 * Terrain::pickTarget() in the page under @a pos
+		 */
+		Target pickTarget(const glm::vec3 &pos, std::mt19937 &gen) const;
+
+		inline unsigned int getSeed() const
+		{
+			return seed;
+		}
+		inline long long getOriginX() const
+		{
+			return originX;
+		}
+		inline long long getOriginZ() const
+		{
+			return originZ;
+		}
+
+		/**
+		 * Read only view of one slot of the pool, the terrain can only be
+		 * used while the state is PAGE_READY. The version changes every
+		 * time the slot gets a new page
+		 */
+		struct PageView {
+			PageState state;
+			unsigned int version;
+			const Terrain *terrain;
+
+			// Center of the page, relative to the origin
+			glm::vec3 offset;
+		};
+
+		PageView getPage(int slot) const;
+
+		/**
+		 * Pages generated since start(), evicted ones included
+		 */
+		inline unsigned long long getGeneratedCount() const
+		{
+			return generated;
+		}
+
+	private:
+		struct Slot {
+			std::unique_ptr<Terrain> terrain;
+			long long x = 0;
+			long long z = 0;
+
+			std::atomic<int> state{ PAGE_FREE };
+			unsigned int version = 0;
+			unsigned long long lastUsed = 0;
+		};
+
+		Slot slots[STREAM_POOL_SIZE];
+
+		unsigned int seed = 0;
+		long long originX = 0;
+		long long originZ = 0;
+		unsigned long long tick = 0;
+		std::atomic<unsigned long long> generated{ 0 };
+
+		// Slots waiting for the worker, nearest pages first
+		std::deque<int> queue;
+		bool busy = false;
+		bool stopping = false;
+
+		std::mutex mutex;
+		std::condition_variable wake;
+		std::condition_variable done;
+
+		std::thread worker;
+
+		// Only used by the worker, to spread one page over the cores
+		std::unique_ptr<ThreadPool> pool;
+
+		void work();
+		void drain();
+
+		long long pageOf(float v) const;
+		glm::vec3 pageOffset(long long x, long long z) const;
+
+		int findSlot(long long x, long long z) const;
+		const Terrain *readyPage(long long x, long long z) const;
+
+		/**
+		 * Marks the page as used, queueing it in a free or least recently
+		 * used slot if it is not in the pool. Returns false if no slot
+		 * can take it yet
+		 */
+		bool touch(long long x, long long z);
+		void requestAround(long long x, long long z);
+	};
+
+} // namespace obj3D
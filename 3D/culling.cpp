@@ -0,0 +1,98 @@
+#include "culling.h"
+
+#include <algorithm>
+
+#define BVH_LEAF_SIZE 4
+
+using namespace obj3D;
+
+Frustum::Frustum(const glm::mat4 &clip)
+{
+	auto row = [&clip](int i) {
+		return glm::vec4(clip[0][i], clip[1][i], clip[2][i], clip[3][i]);
+	};
+
+	planes[0] = row(3) + row(0); // left
+	planes[1] = row(3) - row(0); // right
+	planes[2] = row(3) + row(1); // bottom
+	planes[3] = row(3) - row(1); // top
+	planes[4] = row(3) + row(2); // near
+	planes[5] = row(3) - row(2); // far
+}
+
+Frustum::Result Frustum::classify(const AABB &box) const
+{
+	Result res = INSIDE;
+
+	for (auto &&plane : planes) {
+		glm::vec3 n(plane);
+
+		// Corners furthest along and against the plane normal
+		glm::vec3 pos(n.x >= 0 ? box.max.x : box.min.x,
+			n.y >= 0 ? box.max.y : box.min.y,
+			n.z >= 0 ? box.max.z : box.min.z);
+		glm::vec3 neg(n.x >= 0 ? box.min.x : box.max.x,
+			n.y >= 0 ? box.min.y : box.max.y,
+			n.z >= 0 ? box.min.z : box.max.z);
+
+		if (glm::dot(n, pos) + plane.w < 0) {
+			return OUTSIDE;
+		}
+		if (glm::dot(n, neg) + plane.w < 0) {
+			res = INTERSECT;
+		}
+	}
+
+	return res;
+}
+
+void BVH::build(const std::vector<AABB> &boxes)
+{
+	nodes.clear();
+	items.resize(boxes.size());
+	this->boxes = boxes;
+
+	for (unsigned int i = 0; i < items.size(); i++) {
+		items[i] = i;
+	}
+
+	if (!boxes.empty()) {
+		nodes.reserve(2 * boxes.size() / BVH_LEAF_SIZE + 1);
+		buildNode(0, static_cast<unsigned int>(boxes.size()));
+	}
+}
+
+int BVH::buildNode(unsigned int first, unsigned int count)
+{
+	int idx = static_cast<int>(nodes.size());
+	nodes.emplace_back();
+
+	AABB box = boxes[items[first]];
+	for (unsigned int i = first + 1; i < first + count; i++) {
+		box.expand(boxes[items[i]]);
+	}
+	nodes[idx].box = box;
+
+	if (count <= BVH_LEAF_SIZE) {
+		nodes[idx].first = first;
+		nodes[idx].count = count;
+		return idx;
+	}
+
+	glm::vec3 size = box.max - box.min;
+	int axis = (size.x > size.y && size.x > size.z) ? 0 : (size.y > size.z ? 1 : 2);
+
+	auto begin = items.begin() + first;
+	auto mid = begin + count / 2;
+	std::nth_element(begin, mid, begin + count, [this, axis](unsigned int a, unsigned int b) {
+		return boxes[a].center()[axis] < boxes[b].center()[axis];
+	});
+
+	int left = buildNode(first, count / 2);
+	int right = buildNode(first + count / 2, count - count / 2);
+
+	nodes[idx].left = left;
+	nodes[idx].right = right;
+
+	return idx;
+}
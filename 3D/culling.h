@@ -0,0 +1,148 @@
+#pragma once
+
+#include <vector>
+
+#include "utils/glm_utils.h"
+
+namespace obj3D {
+
+	struct AABB {
+		glm::vec3 min;
+		glm::vec3 max;
+
+		AABB() : min(0), max(0) {}
+		AABB(const glm::vec3 &min, const glm::vec3 &max) : min(min), max(max) {}
+
+		inline glm::vec3 center() const
+		{
+			return (min + max) / 2.f;
+		}
+
+		inline void expand(const AABB &o)
+		{
+			min = glm::min(min, o.min);
+			max = glm::max(max, o.max);
+		}
+	};
+
+	/**
+	 * The 6 planes of a view frustum, facing inwards
+	 */
+	class Frustum {
+	public:
+		enum Result { OUTSIDE, INTERSECT, INSIDE };
+
+		/**
+		 * @a clip is projection * view
+		 */
+		explicit Frustum(const glm::mat4 &clip);
+
+		Result classify(const AABB &box) const;
+
+		inline bool intersects(const AABB &box) const
+		{
+			return classify(box) != OUTSIDE;
+		}
+
+	private:
+		glm::vec4 planes[6];
+	};
+
+	/**
+	 * Static bounding volume hierarchy over a set of boxes,
+	 * split at the median of the longest axis
+	 */
+	class BVH {
+	public:
+		BVH() {}
+
+		void build(const std::vector<AABB> &boxes);
+
+		/**
+		 * Calls @a visit with the index of every box that is (partially) in @a frustum
+		 */
+		template <typename Visit>
+		void query(const Frustum &frustum, Visit visit) const
+		{
+			if (!nodes.empty()) {
+				query(0, frustum, visit);
+			}
+		}
+
+		inline size_t size() const
+		{
+			return items.size();
+		}
+
+		/**
+		 * Bytes held by the nodes and the boxes
+		 */
+		inline size_t memoryUsage() const
+		{
+			return nodes.capacity() * sizeof(Node) + items.capacity() * sizeof(unsigned int)
+				+ boxes.capacity() * sizeof(AABB);
+		}
+
+	private:
+		struct Node {
+			AABB box;
+
+			// Children for inner nodes, item range for leaves
+			int left = -1;
+			int right = -1;
+			unsigned int first = 0;
+			unsigned int count = 0;
+		};
+
+		std::vector<Node> nodes;
+		std::vector<unsigned int> items;
+		std::vector<AABB> boxes;
+
+		int buildNode(unsigned int first, unsigned int count);
+
+		template <typename Visit>
+		void query(int idx, const Frustum &frustum, Visit &visit) const
+		{
+			const Node &node = nodes[idx];
+
+			auto res = frustum.classify(node.box);
+			if (res == Frustum::OUTSIDE) {
+				return;
+			}
+
+			if (res == Frustum::INSIDE) {
+				visitAll(idx, visit);
+				return;
+			}
+
+			if (node.count > 0) {
+				for (unsigned int i = node.first; i < node.first + node.count; i++) {
+					if (frustum.intersects(boxes[items[i]])) {
+						visit(items[i]);
+					}
+				}
+				return;
+			}
+
+			query(node.left, frustum, visit);
+			query(node.right, frustum, visit);
+		}
+
+		template <typename Visit>
+		void visitAll(int idx, Visit &visit) const
+		{
+			const Node &node = nodes[idx];
+
+			if (node.count > 0) {
+				for (unsigned int i = node.first; i < node.first + node.count; i++) {
+					visit(items[i]);
+				}
+				return;
+			}
+
+			visitAll(node.left, visit);
+			visitAll(node.right, visit);
+		}
+	};
+
+} // namespace obj3D
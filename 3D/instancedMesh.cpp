@@ -0,0 +1,124 @@
+#include "instancedMesh.h"
+
+#include <cstddef>
+
+using namespace obj3D;
+
+InstancedMesh::~InstancedMesh()
+{
+	release();
+}
+
+void InstancedMesh::release()
+{
+	if (vao == 0) {
+		return;
+	}
+
+	glDeleteBuffers(1, &vbo);
+	glDeleteBuffers(1, &ibo);
+	glDeleteBuffers(1, &instanceVbo);
+	glDeleteVertexArrays(1, &vao);
+
+	vao = vbo = ibo = instanceVbo = 0;
+	nrIndices = nrInstances = capacity = 0;
+}
+
+void InstancedMesh::init(const Mesh *mesh)
+{
+	release();
+
+	glGenVertexArrays(1, &vao);
+	glBindVertexArray(vao);
+
+	glGenBuffers(1, &vbo);
+	glBindBuffer(GL_ARRAY_BUFFER, vbo);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(VertexFormat) * mesh->vertices.size(),
+		mesh->vertices.data(), GL_STATIC_DRAW);
+
+	glGenBuffers(1, &ibo);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(unsigned int) * mesh->indices.size(),
+		mesh->indices.data(), GL_STATIC_DRAW);
+
+	// Same layout as the framework meshes
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(VertexFormat),
+		reinterpret_cast<void *>(offsetof(VertexFormat, position)));
+	glEnableVertexAttribArray(1);
+	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(VertexFormat),
+		reinterpret_cast<void *>(offsetof(VertexFormat, normal)));
+	glEnableVertexAttribArray(2);
+	glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(VertexFormat),
+		reinterpret_cast<void *>(offsetof(VertexFormat, text_coord)));
+	glEnableVertexAttribArray(3);
+	glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(VertexFormat),
+		reinterpret_cast<void *>(offsetof(VertexFormat, color)));
+
+	// One model matrix per instance, as 4 columns
+	glGenBuffers(1, &instanceVbo);
+	glBindBuffer(GL_ARRAY_BUFFER, instanceVbo);
+
+	for (int i = 0; i < 4; i++) {
+		glEnableVertexAttribArray(4 + i);
+		glVertexAttribPointer(4 + i, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4),
+			reinterpret_cast<void *>(sizeof(glm::vec4) * i));
+		glVertexAttribDivisor(4 + i, 1);
+	}
+
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	nrIndices = static_cast<GLsizei>(mesh->indices.size());
+}
+
+void InstancedMesh::setInstances(const std::vector<glm::mat4> &matrices, RenderCounters *counters)
+{
+	nrInstances = capacity = static_cast<GLsizei>(matrices.size());
+
+	glBindBuffer(GL_ARRAY_BUFFER, instanceVbo);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(glm::mat4) * matrices.size(),
+		matrices.data(), GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	if (counters != nullptr) {
+		counters->upload(sizeof(glm::mat4) * matrices.size());
+	}
+}
+
+void InstancedMesh::updateInstances(const std::vector<glm::mat4> &matrices, RenderCounters *counters)
+{
+	if (static_cast<GLsizei>(matrices.size()) > capacity) {
+		setInstances(matrices, counters);
+		return;
+	}
+
+	nrInstances = static_cast<GLsizei>(matrices.size());
+	if (nrInstances == 0) {
+		return;
+	}
+
+	glBindBuffer(GL_ARRAY_BUFFER, instanceVbo);
+	glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(glm::mat4) * matrices.size(), matrices.data());
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	if (counters != nullptr) {
+		counters->upload(sizeof(glm::mat4) * matrices.size());
+	}
+}
+
+void InstancedMesh::render(RenderCounters *counters) const
+{
+	if (vao == 0 || nrInstances == 0) {
+		return;
+	}
+
+	glBindVertexArray(vao);
+	glDrawElementsInstanced(GL_TRIANGLES, nrIndices, GL_UNSIGNED_INT, 0, nrInstances);
+	glBindVertexArray(0);
+
+	if (counters != nullptr) {
+		counters->bufferBinds++;
+		counters->draw(static_cast<unsigned long long>(nrIndices / 3) * nrInstances);
+	}
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <vector>
+
+#include "core/gpu/mesh.h"
+
+#include "renderCounters.h"
+
+namespace obj3D {
+
+	/**
+	 * Geometry of a mesh drawn many times with a single instanced draw call
+	 * Each instance reads its model matrix from attributes 4-7
+	 */
+	class InstancedMesh {
+	public:
+		InstancedMesh() {}
+		~InstancedMesh();
+
+		InstancedMesh(const InstancedMesh &) = delete;
+		InstancedMesh &operator=(const InstancedMesh &) = delete;
+
+		/**
+		 * Copies the vertices and indices of @a mesh into buffers of its own
+		 */
+		void init(const Mesh *mesh);
+
+		/**
+		 * The GL calls of these and of render() are added to @a counters, if given
+		 */
+		void setInstances(const std::vector<glm::mat4> &matrices, RenderCounters *counters = nullptr);
+
+		/**
+		 * Overwrites the start of the instance buffer, only
+		 * the first @a matrices.size() instances will be drawn
+		 */
+		void updateInstances(const std::vector<glm::mat4> &matrices, RenderCounters *counters = nullptr);
+
+		void render(RenderCounters *counters = nullptr) const;
+
+		inline GLsizei getInstanceCount() const
+		{
+			return nrInstances;
+		}
+
+	private:
+		GLuint vao = 0;
+		GLuint vbo = 0;
+		GLuint ibo = 0;
+		GLuint instanceVbo = 0;
+
+		GLsizei nrIndices = 0;
+		GLsizei nrInstances = 0;
+		GLsizei capacity = 0;
+
+		void release();
+	};
+
+} // namespace obj3D
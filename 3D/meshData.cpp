@@ -0,0 +1,65 @@
+#include "meshData.h"
+
+#include <algorithm>
+
+using namespace obj3D;
+
+MeshData &MeshData::transform(const glm::mat4 &matrix)
+{
+	glm::mat3 normalMatrix = glm::mat3(glm::transpose(glm::inverse(matrix)));
+
+	for (auto &&vertex : vertices) {
+		vertex.position = glm::vec3(matrix * glm::vec4(vertex.position, 1.f));
+		vertex.normal = glm::normalize(normalMatrix * vertex.normal);
+	}
+
+	return *this;
+}
+
+MeshData &MeshData::translate(glm::vec3 offset)
+{
+	for (auto &&vertex : vertices) {
+		vertex.position += offset;
+	}
+
+	return *this;
+}
+
+MeshData &MeshData::append(const MeshData &other)
+{
+	auto off = static_cast<unsigned int>(vertices.size());
+
+	vertices.insert(vertices.end(), other.vertices.begin(), other.vertices.end());
+
+	// At least doubled when it runs out, so that many appends stay linear
+	size_t nrIndices = indices.size() + other.indices.size();
+	if (nrIndices > indices.capacity()) {
+		indices.reserve(std::max(nrIndices, 2 * indices.capacity()));
+	}
+
+	for (unsigned int idx : other.indices) {
+		indices.push_back(idx + off);
+	}
+
+	return *this;
+}
+
+MeshData MeshData::merge(std::initializer_list<MeshData> parts)
+{
+	MeshData res;
+
+	size_t nrVertices = 0, nrIndices = 0;
+	for (const MeshData &part : parts) {
+		nrVertices += part.vertices.size();
+		nrIndices += part.indices.size();
+	}
+
+	res.vertices.reserve(nrVertices);
+	res.indices.reserve(nrIndices);
+
+	for (const MeshData &part : parts) {
+		res.append(part);
+	}
+
+	return res;
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <initializer_list>
+
+#include "core/gpu/vertex_format.h"
+
+class Mesh;
+
+namespace obj3D {
+
+	/**
+	 * Geometry kept on the CPU while it is put together from parts
+	 * Nothing reaches the GPU before upload(), so only finished meshes get buffers
+	 */
+	struct MeshData {
+		std::vector<VertexFormat> vertices;
+		std::vector<unsigned int> indices;
+
+		/**
+		 * Positions are moved by @a matrix, normals by its rotation and scale
+		 */
+		MeshData &transform(const glm::mat4 &matrix);
+		MeshData &translate(glm::vec3 offset);
+
+		/**
+		 * Adds the triangles of @a other after the ones already here
+		 */
+		MeshData &append(const MeshData &other);
+
+		static MeshData merge(std::initializer_list<MeshData> parts);
+
+		/**
+		 * A new mesh drawn as triangles, owned by the caller
+		 * The only GL call, kept in meshDataUpload.cpp so that the rest builds headless
+		 */
+		Mesh *upload(const std::string &name) const;
+	};
+
+} // namespace obj3D
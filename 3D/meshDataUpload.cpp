@@ -0,0 +1,15 @@
+#include "meshData.h"
+
+#include "core/gpu/mesh.h"
+
+using namespace obj3D;
+
+Mesh *MeshData::upload(const std::string &name) const
+{
+	Mesh *mesh = new Mesh(name);
+
+	mesh->InitFromData(vertices, indices);
+	mesh->SetDrawMode(GL_TRIANGLES);
+
+	return mesh;
+}
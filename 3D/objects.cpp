@@ -1,56 +1,83 @@
 #include "objects.h"
 
+#include <map>
 #include <vector>
+#include <algorithm>
 
+using namespace obj3D;
 using std::vector;
 
-Mesh *obj3D::combineMeshes(const std::string &name, std::initializer_list<Mesh *> meshes)
-{
-	vector<VertexFormat> vRes;
-	vector<unsigned int> iRes;
-	size_t off = 0;
+namespace {
+
+	enum PrimitiveKind { PRIMITIVE_RECTANGLE, PRIMITIVE_BOX, PRIMITIVE_CYLINDER, PRIMITIVE_CONE };
+
+	/**
+	 * Everything a primitive at the origin depends on
+	 */
+	struct PrimitiveKey {
+		PrimitiveKind kind;
+		float size[3];
+		glm::vec3 color;
 
-	for (Mesh *mesh : meshes) {
-		vRes.insert(vRes.end(), mesh->vertices.begin(), mesh->vertices.end());
+		bool operator<(const PrimitiveKey &other) const
+		{
+			if (kind != other.kind) {
+				return kind < other.kind;
+			}
 
-		for (unsigned int idx : mesh->indices) {
-			iRes.push_back(idx + off);
+			const float a[6] = { size[0], size[1], size[2], color.x, color.y, color.z };
+			const float b[6] = { other.size[0], other.size[1], other.size[2],
+				other.color.x, other.color.y, other.color.z };
+
+			return std::lexicographical_compare(a, a + 6, b, b + 6);
 		}
+	};
 
-		off = vRes.size();
+	std::map<PrimitiveKey, MeshData> primitiveCache;
+
+} // namespace
+
+template <typename Build>
+static const MeshData &cachedPrimitive(const PrimitiveKey &key, Build build)
+{
+	auto it = primitiveCache.find(key);
+	if (it == primitiveCache.end()) {
+		it = primitiveCache.emplace(key, build()).first;
 	}
 
-	Mesh *res = new Mesh(name);
-	res->InitFromData(vRes, iRes);
+	return it->second;
+}
 
-	return res;
+size_t obj3D::primitiveCacheSize()
+{
+	return primitiveCache.size();
 }
 
-/**
- * Center is at bottom left corner
- */
-Mesh *obj3D::createRectangle(const std::string &name, glm::vec3 corner, float h, float L, glm::vec3 color)
+void obj3D::clearPrimitiveCache()
 {
-	vector<VertexFormat> vertices =
-	{
-		VertexFormat(corner + glm::vec3(0, 0, h), color),
-		VertexFormat(corner + glm::vec3(L, 0, h), color),
-		VertexFormat(corner + glm::vec3(L, 0, 0), color),
-		VertexFormat(corner + glm::vec3(0, 0, 0), color)
-	};
+	primitiveCache.clear();
+}
+
+static MeshData buildRectangle(float h, float L, glm::vec3 color)
+{
+	MeshData res;
 
-	Mesh *rectangle = new Mesh(name);
-	vector<unsigned int> indices = { 0, 1, 2, 3, 0, 2 };
+	res.vertices = {
+		VertexFormat(glm::vec3(0, 0, h), color),
+		VertexFormat(glm::vec3(L, 0, h), color),
+		VertexFormat(glm::vec3(L, 0, 0), color),
+		VertexFormat(glm::vec3(0, 0, 0), color)
+	};
+	res.indices = { 0, 1, 2, 3, 0, 2 };
 
-	rectangle->InitFromData(vertices, indices);
-	return rectangle;
+	return res;
 }
 
-Mesh *obj3D::createCylinder(const std::string &name, glm::vec3 center,
-	float h, float r, glm::vec3 color)
+static MeshData buildCylinder(float h, float r, glm::vec3 color)
 {
-	vector<VertexFormat> vertices;
-	vector<unsigned int> indices;
+	MeshData res;
+	vector<VertexFormat> &vertices = res.vertices;
+	vector<unsigned int> &indices = res.indices;
 
 	int nrSegments = 36;
 	float angleStep = 2.0f * glm::pi<float>() / nrSegments;
@@ -60,8 +87,8 @@ Mesh *obj3D::createCylinder(const std::string &name, glm::vec3 center,
 		float x = cos(angle) * r;
 		float z = sin(angle) * r;
 
-		vertices.push_back(VertexFormat(center + glm::vec3(x, h, z), color));
-		vertices.push_back(VertexFormat(center + glm::vec3(x, 0, z), color));
+		vertices.push_back(VertexFormat(glm::vec3(x, h, z), color));
+		vertices.push_back(VertexFormat(glm::vec3(x, 0, z), color));
 	}
 
 	for (int i = 0; i < nrSegments; i++) {
@@ -92,21 +119,17 @@ Mesh *obj3D::createCylinder(const std::string &name, glm::vec3 center,
 		indices.push_back(bottomCenter + ((i) * 2));
 	}
 
-	Mesh *cylinder = new Mesh(name);
-	cylinder->InitFromData(vertices, indices);
-	cylinder->SetDrawMode(GL_TRIANGLES);
-
-	return cylinder;
+	return res;
 }
 
-Mesh *obj3D::createCone(const std::string &name, glm::vec3 center,
-	float h, float r, glm::vec3 color)
+static MeshData buildCone(float h, float r, glm::vec3 color)
 {
-	vector<VertexFormat> vertices;
-	vector<unsigned int> indices;
+	MeshData res;
+	vector<VertexFormat> &vertices = res.vertices;
+	vector<unsigned int> &indices = res.indices;
 
-	vertices.push_back(VertexFormat(center, color));
-	vertices.push_back(VertexFormat(center + glm::vec3(0, h, 0), color - glm::vec3(0.15f)));
+	vertices.push_back(VertexFormat(glm::vec3(0), color));
+	vertices.push_back(VertexFormat(glm::vec3(0, h, 0), color - glm::vec3(0.15f)));
 
 	int nrSegments = 36;
 	float angleStep = 2.0f * glm::pi<float>() / nrSegments;
@@ -116,7 +139,7 @@ Mesh *obj3D::createCone(const std::string &name, glm::vec3 center,
 		float x = cos(angle) * r;
 		float z = sin(angle) * r;
 
-		vertices.push_back(VertexFormat(center + glm::vec3(x, 0, z), color));
+		vertices.push_back(VertexFormat(glm::vec3(x, 0, z), color));
 
 		if (i > 0) {
 			indices.push_back(0);
@@ -129,45 +152,30 @@ Mesh *obj3D::createCone(const std::string &name, glm::vec3 center,
 		}
 	}
 
-	Mesh *circle = new Mesh(name);
-	circle->InitFromData(vertices, indices);
-	circle->SetDrawMode(GL_TRIANGLES);
-
-	return circle;
+	return res;
 }
 
-Mesh *obj3D::createRectangleParallelepiped(const std::string &name, glm::vec3 center,
-	float l, float L, float h, glm::vec3 color, float angle)
+static MeshData buildRectangleParallelepiped(float l, float L, float h, glm::vec3 color)
 {
-	vector<VertexFormat> vertices;
-	vector<unsigned int> indices;
+	MeshData res;
 
 	float halfL = L / 2.0f;
 	float halfl = l / 2.0f;
 	float halfH = h / 2.0f;
 
-	glm::mat4 rotationMatrix = glm::rotate(glm::mat4(1.0f), angle, glm::vec3(0.0f, 1.0f, 0.0f));
-
-	vertices = {
-		VertexFormat(glm::vec3(-halfL, -halfH, -halfl)),
-		VertexFormat(glm::vec3(-halfL, -halfH, halfl)),
-		VertexFormat(glm::vec3(halfL, -halfH, -halfl)),
-		VertexFormat(glm::vec3(halfL, -halfH, halfl)),
+	res.vertices = {
+		VertexFormat(glm::vec3(-halfL, -halfH, -halfl), color),
+		VertexFormat(glm::vec3(-halfL, -halfH, halfl), color),
+		VertexFormat(glm::vec3(halfL, -halfH, -halfl), color),
+		VertexFormat(glm::vec3(halfL, -halfH, halfl), color),
 
-		VertexFormat(glm::vec3(-halfL, halfH, -halfl)),
-		VertexFormat(glm::vec3(-halfL, halfH, halfl)),
-		VertexFormat(glm::vec3(halfL, halfH, -halfl)),
-		VertexFormat(glm::vec3(halfL, halfH, halfl))
+		VertexFormat(glm::vec3(-halfL, halfH, -halfl), color),
+		VertexFormat(glm::vec3(-halfL, halfH, halfl), color),
+		VertexFormat(glm::vec3(halfL, halfH, -halfl), color),
+		VertexFormat(glm::vec3(halfL, halfH, halfl), color)
 	};
 
-	for (auto &&vertex : vertices) {
-		auto rotated = rotationMatrix * glm::vec4(vertex.position, 1.f);
-
-		vertex.position = center + glm::vec3(rotated);
-		vertex.color = color;
-	}
-
-	indices = {
+	res.indices = {
 		0, 2, 1, 1, 2, 3, // top
 		4, 6, 5, 5, 6, 7, // bottom
 
@@ -178,9 +186,68 @@ Mesh *obj3D::createRectangleParallelepiped(const std::string &name, glm::vec3 ce
 		3, 2, 7, 2, 6, 7 // back
 	};
 
-	Mesh *rectangle = new Mesh(name);
-	rectangle->InitFromData(vertices, indices);
-	rectangle->SetDrawMode(GL_TRIANGLES);
+	return res;
+}
+
+/**
+ * Center is at bottom left corner
+ */
+MeshData obj3D::makeRectangle(glm::vec3 corner, float h, float L, glm::vec3 color)
+{
+	PrimitiveKey key = { PRIMITIVE_RECTANGLE, { h, L, 0 }, color };
+
+	MeshData res = cachedPrimitive(key, [=]() { return buildRectangle(h, L, color); });
+	return res.translate(corner);
+}
+
+MeshData obj3D::makeRectangleParallelepiped(glm::vec3 center,
+	float l, float L, float h, glm::vec3 color, float angle)
+{
+	PrimitiveKey key = { PRIMITIVE_BOX, { l, L, h }, color };
+
+	MeshData res = cachedPrimitive(key, [=]() { return buildRectangleParallelepiped(l, L, h, color); });
+	if (angle != 0) {
+		res.transform(glm::rotate(glm::mat4(1.0f), angle, glm::vec3(0.0f, 1.0f, 0.0f)));
+	}
+
+	return res.translate(center);
+}
+
+MeshData obj3D::makeCylinder(glm::vec3 center, float h, float r, glm::vec3 color)
+{
+	PrimitiveKey key = { PRIMITIVE_CYLINDER, { h, r, 0 }, color };
+
+	MeshData res = cachedPrimitive(key, [=]() { return buildCylinder(h, r, color); });
+	return res.translate(center);
+}
+
+MeshData obj3D::makeCone(glm::vec3 center, float h, float r, glm::vec3 color)
+{
+	PrimitiveKey key = { PRIMITIVE_CONE, { h, r, 0 }, color };
 
-	return rectangle;
+	MeshData res = cachedPrimitive(key, [=]() { return buildCone(h, r, color); });
+	return res.translate(center);
+}
+
+Mesh *obj3D::createRectangle(const std::string &name, glm::vec3 corner, float h, float L, glm::vec3 color)
+{
+	return makeRectangle(corner, h, L, color).upload(name);
+}
+
+Mesh *obj3D::createCylinder(const std::string &name, glm::vec3 center,
+	float h, float r, glm::vec3 color)
+{
+	return makeCylinder(center, h, r, color).upload(name);
+}
+
+Mesh *obj3D::createCone(const std::string &name, glm::vec3 center,
+	float h, float r, glm::vec3 color)
+{
+	return makeCone(center, h, r, color).upload(name);
+}
+
+Mesh *obj3D::createRectangleParallelepiped(const std::string &name, glm::vec3 center,
+	float l, float L, float h, glm::vec3 color, float angle)
+{
+	return makeRectangleParallelepiped(center, l, L, h, color, angle).upload(name);
 }
@@ -1,10 +1,26 @@
 #pragma once
 
 #include "core/gpu/mesh.h"
+#include "meshData.h"
 
 namespace obj3D {
 
-	Mesh *combineMeshes(const std::string &name, std::initializer_list<Mesh *> meshes);
+	/**
+	 * Primitives built on the CPU. Each set of parameters is only
+	 * tessellated once, later calls copy it from a cache and move it
+	 * in place. The cache is not thread safe, meshes are built at startup
+	 */
+	MeshData makeRectangle(glm::vec3 corner, float h, float L, glm::vec3 color);
+	MeshData makeRectangleParallelepiped(glm::vec3 center,
+		float l, float L, float h, glm::vec3 color, float angle = 0);
+	MeshData makeCylinder(glm::vec3 center, float h, float r, glm::vec3 color);
+	MeshData makeCone(glm::vec3 center, float h, float r, glm::vec3 color);
+
+	/**
+	 * Number of distinct primitives in the cache
+	 */
+	size_t primitiveCacheSize();
+	void clearPrimitiveCache();
 
 	/**
 	 * Center is at half the left side (height)
@@ -0,0 +1,41 @@
+#pragma once
+
+namespace obj3D {
+
+	/**
+	 * GL work submitted over a pass or a frame
+	 * Binds count vertex arrays and buffer objects, not the unbinding to 0
+	 */
+	struct RenderCounters {
+		unsigned int drawCalls = 0;
+		unsigned long long triangles = 0;
+		unsigned int programBinds = 0;
+		unsigned int uniformUploads = 0;
+		unsigned int bufferBinds = 0;
+		unsigned long long bytesUploaded = 0;
+
+		inline void draw(unsigned long long nrTriangles)
+		{
+			drawCalls++;
+			triangles += nrTriangles;
+		}
+
+		inline void upload(unsigned long long nrBytes)
+		{
+			bufferBinds++;
+			bytesUploaded += nrBytes;
+		}
+
+		inline RenderCounters &operator+=(const RenderCounters &other)
+		{
+			drawCalls += other.drawCalls;
+			triangles += other.triangles;
+			programBinds += other.programBinds;
+			uniformUploads += other.uniformUploads;
+			bufferBinds += other.bufferBinds;
+			bytesUploaded += other.bytesUploaded;
+			return *this;
+		}
+	};
+
+} // namespace obj3D
@@ -0,0 +1,88 @@
+#include "threadPool.h"
+
+#include <algorithm>
+
+using namespace obj3D;
+
+ThreadPool::ThreadPool(unsigned int nrThreads)
+{
+	if (nrThreads == 0) {
+		nrThreads = std::max(1u, std::thread::hardware_concurrency());
+	}
+
+	for (unsigned int i = 1; i < nrThreads; i++) {
+		workers.emplace_back(&ThreadPool::work, this);
+	}
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	wake.notify_all();
+
+	for (auto &&worker : workers) {
+		worker.join();
+	}
+}
+
+void ThreadPool::parallelFor(size_t count, const std::function<void(size_t)> &job)
+{
+	if (workers.empty() || count <= 1) {
+		for (size_t i = 0; i < count; i++) {
+			job(i);
+		}
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		this->job = &job;
+		this->count = count;
+		next = 0;
+
+		busy = static_cast<unsigned int>(workers.size());
+		generation++;
+	}
+	wake.notify_all();
+
+	runJobs();
+
+	std::unique_lock<std::mutex> lock(mutex);
+	done.wait(lock, [this]() { return busy == 0; });
+
+	this->job = nullptr;
+}
+
+void ThreadPool::runJobs()
+{
+	for (size_t i = next++; i < count; i = next++) {
+		(*job)(i);
+	}
+}
+
+void ThreadPool::work()
+{
+	unsigned long long seen = 0;
+
+	std::unique_lock<std::mutex> lock(mutex);
+
+	for (;;) {
+		wake.wait(lock, [this, seen]() { return stopping || generation != seen; });
+		if (stopping) {
+			return;
+		}
+		seen = generation;
+
+		lock.unlock();
+		runJobs();
+		lock.lock();
+
+		if (--busy == 0) {
+			done.notify_one();
+		}
+	}
+}
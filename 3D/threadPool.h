@@ -0,0 +1,75 @@
+#pragma once
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <functional>
+#include <condition_variable>
+
+namespace obj3D {
+
+	/**
+	 * Fixed set of worker threads running parallel loops
+	 * The calling thread works on the loop too, so a pool of size 1 has
+	 * no workers and runs everything inline
+	 */
+	class ThreadPool {
+	public:
+		/**
+		 * @a nrThreads counts the calling thread, 0 picks one per hardware thread
+		 */
+		explicit ThreadPool(unsigned int nrThreads = 0);
+		~ThreadPool();
+
+		ThreadPool(const ThreadPool &) = delete;
+		ThreadPool &operator=(const ThreadPool &) = delete;
+
+		inline unsigned int size() const
+		{
+			return static_cast<unsigned int>(workers.size()) + 1;
+		}
+
+		/**
+		 * Calls @a job with every index in [0, @a count), in no particular
+		 * order, and returns once all the calls are done
+		 * Not reentrant: @a job must not use the pool itself
+		 */
+		void parallelFor(size_t count, const std::function<void(size_t)> &job);
+
+	private:
+		std::vector<std::thread> workers;
+
+		std::mutex mutex;
+		std::condition_variable wake;
+		std::condition_variable done;
+
+		// Current loop, handed out one index at a time
+		const std::function<void(size_t)> *job = nullptr;
+		size_t count = 0;
+		std::atomic<size_t> next{ 0 };
+
+		unsigned long long generation = 0;
+		unsigned int busy = 0;
+		bool stopping = false;
+
+		void work();
+		void runJobs();
+	};
+
+	/**
+	 * ThreadPool::parallelFor() on @a pool, or a plain loop without one
+	 */
+	inline void parallelFor(ThreadPool *pool, size_t count, const std::function<void(size_t)> &job)
+	{
+		if (pool != nullptr) {
+			pool->parallelFor(count, job);
+			return;
+		}
+
+		for (size_t i = 0; i < count; i++) {
+			job(i);
+		}
+	}
+
+} // namespace obj3D
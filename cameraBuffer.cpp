@@ -0,0 +1,54 @@
+#include "cameraBuffer.h"
+
+using namespace m1;
+
+CameraBuffer::~CameraBuffer()
+{
+	if (ubo != 0) {
+		glDeleteBuffers(1, &ubo);
+	}
+}
+
+void CameraBuffer::init()
+{
+	if (ubo != 0) {
+		return;
+	}
+
+	glGenBuffers(1, &ubo);
+	glBindBuffer(GL_UNIFORM_BUFFER, ubo);
+	glBufferData(GL_UNIFORM_BUFFER, sizeof(CameraBlock), nullptr, GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+	glBindBufferBase(GL_UNIFORM_BUFFER, CAMERA_BLOCK_BINDING, ubo);
+}
+
+void CameraBuffer::attach(const Shader *shader) const
+{
+	if (shader == nullptr || !shader->program) {
+		return;
+	}
+
+	GLuint idx = glGetUniformBlockIndex(shader->program, CAMERA_BLOCK_NAME);
+	if (idx != GL_INVALID_INDEX) {
+		glUniformBlockBinding(shader->program, idx, CAMERA_BLOCK_BINDING);
+	}
+}
+
+void CameraBuffer::update(const glm::mat4 &view, const glm::mat4 &projection,
+	const glm::vec3 &dronePos, bool fow, obj3D::RenderCounters *counters)
+{
+	CameraBlock block;
+	block.view = view;
+	block.projection = projection;
+	block.dronePos = glm::vec4(dronePos, 1);
+	block.fow = fow;
+
+	glBindBuffer(GL_UNIFORM_BUFFER, ubo);
+	glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(CameraBlock), &block);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+	if (counters != nullptr) {
+		counters->upload(sizeof(CameraBlock));
+	}
+}
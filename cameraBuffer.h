@@ -0,0 +1,49 @@
+#pragma once
+
+#include "core/gpu/shader.h"
+#include "utils/glm_utils.h"
+
+#include "3D/renderCounters.h"
+
+#define CAMERA_BLOCK_NAME "Camera"
+#define CAMERA_BLOCK_BINDING 0
+
+namespace m1 {
+
+	/**
+	 * Per pass data, laid out as the std140 `Camera` block of the game shaders
+	 */
+	struct CameraBlock {
+		glm::mat4 view;
+		glm::mat4 projection;
+		glm::vec4 dronePos;
+		GLint fow;
+		GLint pad[3];
+	};
+
+	/**
+	 * Uniform buffer shared by all the game shaders, uploaded once per pass
+	 */
+	class CameraBuffer {
+	public:
+		CameraBuffer() {}
+		~CameraBuffer();
+
+		CameraBuffer(const CameraBuffer &) = delete;
+		CameraBuffer &operator=(const CameraBuffer &) = delete;
+
+		void init();
+
+		/**
+		 * Points the `Camera` block of @a shader to this buffer
+		 */
+		void attach(const Shader *shader) const;
+
+		void update(const glm::mat4 &view, const glm::mat4 &projection,
+			const glm::vec3 &dronePos, bool fow, obj3D::RenderCounters *counters = nullptr);
+
+	private:
+		GLuint ubo = 0;
+	};
+
+} // namespace m1
@@ -8,3 +8,6 @@
 #define COLOR_RED glm::vec3(1.f, 0.1f, 0.1f)
 #define COLOR_BLUE glm::vec3(0.1f, 0.1f, 1)
 #define COLOR_YELLOW glm::vec3(0.8f, 0.8f, 0.1f)
+
+#define COLOR_SKY glm::vec3(0.3f, 0.3f, 0.8f)
+#define COLOR_NIGHT_SKY glm::vec3(0.01f, 0.01f, 0.06f)
@@ -2,17 +2,32 @@
 
 #include <vector>
 #include <string>
+#include <random>
+#include <cstdio>
 
 using namespace std;
 using namespace m1;
 
-#define MAP_SIZE_Z 100
-#define MAP_SIZE_X (MAP_SIZE_Z + 10)
-#define MAP_SIZE_Y 15
+#define FONT_SIZE 18
 
-#define MAP_OBSTACLES (MAP_SIZE_X * MAP_SIZE_Z / 40)
+// Terrain bytes sent to the GPU per frame while the next world is uploaded
+#define TERRAIN_UPLOAD_BUDGET (1 << 20)
 
-#define FONT_SIZE 18
+// Streamed pages sent to the GPU per frame, the others wait for the next frames
+#define STREAM_UPLOADS_PER_FRAME 1
+
+// Written next to the executable by F4
+#define PROFILER_TRACE_FILE "tema2_trace.json"
+
+// Read next to the executable at start, see sim::WorldConfig::load()
+#define WORLD_CONFIG_FILE "tema2_world.cfg"
+
+// Written next to the executable while recording, F5 starts and stops it
+// F6 replays it, or stops the replay
+#define INPUT_TRACE_FILE "tema2_input.trace"
+
+// With fog of war on, the static layer of the minimap depends on the drone position
+#define MINIMAP_FOW_REFRESH 0.1f
 
 
 /*
@@ -40,29 +55,481 @@ void makeThirdPerson(implemented::GameCamera *camera, glm::vec3 target)
 	camera->Set(target - 2.f * fwd + glm::vec3(0, 1.f, 0), target, glm::vec3(0, 1, 0));
 }
 
+unsigned int DroneGame::pickSeed() const
+{
+	unsigned int seed = worldSeed;
+	while (seed == 0) {
+		seed = std::random_device()();
+	}
+
+	return seed;
+}
+
 void DroneGame::restart()
 {
-	score = 0;
+	simThread.stop();
+	dropNextWorld();
+
+	if (streaming) {
+		simulation.restartStreaming(pickSeed());
+		startWorld();
+		return;
+	}
+
+	if (snapshotPath.empty() || !simulation.restartFromSnapshot(snapshotPath)) {
+		simulation.restart(pickSeed());
+		if (!snapshotPath.empty()) {
+			simulation.saveSnapshot(snapshotPath);
+		}
+	}
+
+	terrainMeshes[frontMesh].upload(simulation.getTerrain().getChunks(), counters);
+	startWorld();
+}
+
+void DroneGame::requestRestart()
+{
+	// Only the pages around the spawn point are waited for
+	if (streaming) {
+		restart();
+		return;
+	}
+
+	restartRequested = true;
+
+	if (!simulation.isPreparingWorld()) {
+		simulation.prepareWorld(pickSeed(), snapshotPath);
+	}
+}
+
+/**
+ * Called between two frames: the next world is uploaded as soon as it is
+ * built, TERRAIN_UPLOAD_BUDGET bytes per frame, and only swapped in
+ * once it is complete and a restart was asked for
+ */
+void DroneGame::updateRestart()
+{
+	const obj3D::Terrain *next = simulation.pollNextWorld();
+	if (next == nullptr) {
+		return;
+	}
+
+	obj3D::TerrainMesh &back = terrainMeshes[1 - frontMesh];
+
+	if (!uploadingNext) {
+		back.beginUpload(next->getChunks());
+		uploadingNext = true;
+	}
+
+	if (!back.uploadStep(TERRAIN_UPLOAD_BUDGET, counters) || !restartRequested) {
+		return;
+	}
+
+	simThread.stop();
+	simulation.swapWorld();
+
+	// The back mesh is now the one of the world just left
+	frontMesh = 1 - frontMesh;
+	dropNextWorld();
+
+	startWorld();
+}
+
+/**
+ * Called on every world change: the simulation drops the world it was
+ * preparing, the upload of that world and a pending restart go with it
+ */
+void DroneGame::dropNextWorld()
+{
+	restartRequested = false;
+
+	if (uploadingNext) {
+		terrainMeshes[1 - frontMesh].release();
+		uploadingNext = false;
+	}
+}
+
+/**
+ * Everything that follows the simulation into a new world
+ */
+void DroneGame::startWorld()
+{
 	feedback = 0;
 
 	fstPerson = true;
 	enableUI = true;
 
-	drone.pos = glm::vec3(0, 5, 0);
-	drone.size = DRONE_SIZE;
-
-	drone.angle = 0;
-	drone.bladeAngle = 0;
-
-	drone.target = nullptr;
+	deliveries = 0;
 
 	if (camera != nullptr) {
 		delete camera;
 	}
 	camera = new implemented::GameCamera();
-	makeFirstPerson(camera, drone.pos);
+	makeFirstPerson(camera, simulation.getDrone().pos);
+
+	view = sim::makeSnapshot(simulation);
+	followPos = view.drone.pos;
+	followAngle = view.drone.angle;
+
+	uploadTerrain();
+	resetSwarm();
+
+	minimapDirty = true;
+
+	recorder.world(simulation);
+
+	// Replays only start the worlds of the trace
+	if (pregenerate && !streaming && !replaying) {
+		simulation.prepareWorld(pickSeed(), snapshotPath);
+	}
+
+	updateSimThread();
+}
+
+/**
+ * The streamer evicts pages from the ticks while the frame draws them,
+ * traces need every frame stepped along with its input
+ */
+void DroneGame::updateSimThread()
+{
+	bool wanted = threadedSimulation && !simulation.isStreaming() && !replaying && !recorder.isOpen();
+
+	if (wanted && !simThread.isRunning()) {
+		simThread.start(simulation);
+	} else if (!wanted) {
+		simThread.stop();
+	}
+}
+
+/**
+ * The swarm only reads the heights and the obstacles of the terrain, which
+ * the simulation thread never changes, so it is stepped on the frame thread
+ * while that one runs
+ */
+void DroneGame::resetSwarm()
+{
+	if (swarmSize > 0 && !simulation.isStreaming()) {
+		auto &terrain = simulation.getTerrain();
+		swarm.reset(terrain, swarmSize, terrain.getSeed(), static_cast<float>(simulation.getWorldConfig().maxY));
+	} else {
+		swarm.clear();
+	}
+
+	uploadSwarm();
+}
+
+void DroneGame::updateSwarm(float deltaTime)
+{
+	if (swarm.advance(deltaTime, &swarmPool) > 0) {
+		uploadSwarm();
+	}
+}
+
+void DroneGame::uploadSwarm()
+{
+	swarm.getMatrices(swarmBases, swarmBlades, &swarmPool);
+
+	instancedMeshes[MESH_BASE].updateInstances(swarmBases, counters);
+	instancedMeshes[MESH_BLADE].updateInstances(swarmBlades, counters);
+}
+
+void DroneGame::setWorldConfig(const sim::WorldConfig &config)
+{
+	bool running = simThread.isRunning();
+
+	simThread.stop();
+	simulation.setConfig(config);
+
+	if (running) {
+		simThread.start(simulation);
+	}
+}
+
+bool DroneGame::startRecording(const std::string &path)
+{
+	if (replaying || !recorder.open(path)) {
+		return false;
+	}
+
+	restart();
+	return true;
+}
+
+void DroneGame::stopRecording()
+{
+	if (recorder.isOpen()) {
+		recorder.close(simulation);
+		updateSimThread();
+	}
+}
+
+bool DroneGame::startReplay(const std::string &path)
+{
+	stopRecording();
+
+	if (!replay.open(path)) {
+		return false;
+	}
+
+	// Everything before the first world is skipped
+	sim::TraceEvent event;
+	while (replay.next(event)) {
+		if (event.kind == sim::TRACE_WORLD) {
+			replaying = true;
+			replayTimes = sim::FrameTimes();
+
+			replayWorld(event);
+			return true;
+		}
+	}
+
+	replay.close();
+	return false;
+}
+
+/**
+ * Blocks until the world of @a event is built, like restart()
+ */
+void DroneGame::replayWorld(const sim::TraceEvent &event)
+{
+	simThread.stop();
+
+	dropNextWorld();
+
+	streaming = event.streaming;
+	sim::startTraceWorld(simulation, event);
+
+	if (!streaming) {
+		terrainMeshes[frontMesh].upload(simulation.getTerrain().getChunks(), counters);
+	}
+	startWorld();
+}
+
+/**
+ * The keys, mouse moves and worlds of a frame were recorded before its
+ * controls, they are replayed in the same order. Returns false once the
+ * trace is over
+ */
+bool DroneGame::replayEvents(sim::InputState &input, float &deltaTime)
+{
+	replayTimes.add(deltaTime * 1000.f);
+
+	sim::TraceEvent event;
+	while (replay.next(event)) {
+		switch (event.kind) {
+		case sim::TRACE_FRAME:
+			input = event.input;
+			deltaTime = event.deltaTime;
+			return true;
+		case sim::TRACE_KEY:
+			handleKey(event.key, event.mods);
+			break;
+		case sim::TRACE_MOUSE:
+			rotateCamera(event.deltaX, event.deltaY);
+			break;
+		case sim::TRACE_WORLD:
+			replayWorld(event);
+			break;
+		case sim::TRACE_END:
+			endReplay(&event.end);
+			return false;
+		}
+	}
+
+	endReplay(nullptr);
+	return false;
+}
+
+void DroneGame::endReplay(const sim::TraceEnd *expected)
+{
+	replaying = false;
+	replay.close();
+	updateSimThread();
+
+	auto times = replayTimes.summarize();
+	std::printf("replay: %zu frames, ms mean %.2f p50 %.2f p95 %.2f p99 %.2f max %.2f\n",
+		replayTimes.size(), times.mean, times.p50, times.p95, times.p99, times.max);
+
+	if (expected == nullptr) {
+		std::printf("replay: trace cut short, nothing to compare against\n");
+		return;
+	}
+
+	sim::TraceEnd got = sim::traceEnd(simulation);
+	if (got == *expected) {
+		std::printf("replay: MATCH, score %d after %llu ticks\n", got.score, got.ticks);
+		return;
+	}
+
+	std::printf("replay: MISMATCH, recorded pos %.6f %.6f %.6f score %d ticks %llu,"
+		" replayed pos %.6f %.6f %.6f score %d ticks %llu\n",
+		expected->pos.x, expected->pos.y, expected->pos.z, expected->score, expected->ticks,
+		got.pos.x, got.pos.y, got.pos.z, got.score, got.ticks);
+}
+
+/**
+ * Obstacle instances of the current world, the terrain mesh is uploaded apart
+ * Streamed pages have the same groups, one per obstacle kind, their
+ * instances are only filled in by culling
+ */
+void DroneGame::uploadTerrain()
+{
+	auto &groups = simulation.getTerrain().getObstacleGroups();
+
+	for (auto &&mesh : instancedMeshes) {
+		mesh.setInstances({}, counters);
+	}
+
+	groupMeshes.clear();
+	for (int kind = 0; kind < obj3D::NR_OBSTACLE_KINDS; kind++) {
+		MeshId id = NR_MESHES;
+
+		switch (kind) {
+		case obj3D::OBSTACLE_TREE:
+			id = MESH_TREE;
+			break;
+		case obj3D::OBSTACLE_BUILDING:
+			id = MESH_BUILDING;
+			break;
+		default:
+			break;
+		}
+
+		groupMeshes.push_back(id);
+		if (id != NR_MESHES && !simulation.isStreaming() && kind < static_cast<int>(groups.size())) {
+			instancedMeshes[id].setInstances(groups[kind].matrices, counters);
+		}
+	}
+
+	visibleObstacles.resize(obj3D::NR_OBSTACLE_KINDS);
+}
 
-	terrain.generate(MAP_SIZE_X, MAP_SIZE_Z, MAP_OBSTACLES, shaders["TerrainShader"]);
+void DroneGame::cullScene(RenderPass pass)
+{
+	visibleChunks.clear();
+	for (auto &&visible : visibleObstacles) {
+		visible.clear();
+	}
+
+	if (simulation.isStreaming()) {
+		cullStats[pass] = cullPages();
+	} else {
+		auto &terrain = simulation.getTerrain();
+
+		obj3D::Frustum frustum(projectionMatrix * viewMatrix);
+		auto &groups = terrain.getObstacleGroups();
+
+		unsigned int nrVisible = 0;
+		terrain.cull(frustum, [&](const obj3D::StaticItem &item) {
+			if (item.kind == obj3D::StaticItem::CHUNK) {
+				visibleChunks.push_back(item.index);
+			} else {
+				visibleObstacles[item.group].push_back(groups[item.group].matrices[item.index]);
+			}
+			nrVisible++;
+		});
+
+		cullStats[pass].visible = nrVisible;
+		cullStats[pass].culled = static_cast<unsigned int>(terrain.getStaticItems().size()) - nrVisible;
+	}
+
+	for (size_t i = 0; i < groupMeshes.size(); i++) {
+		if (groupMeshes[i] != NR_MESHES) {
+			instancedMeshes[groupMeshes[i]].updateInstances(visibleObstacles[i], counters);
+		}
+	}
+}
+
+/**
+ * Every uploaded page is culled in its own coordinates, its visible
+ * obstacles are moved by its offset into the shared instance lists
+ */
+DroneGame::CullStats DroneGame::cullPages()
+{
+	auto &streamer = simulation.getStreamer();
+
+	CullStats stats;
+	unsigned int nrItems = 0;
+
+	for (int i = 0; i < STREAM_POOL_SIZE; i++) {
+		pageChunks[i].clear();
+
+		auto page = streamer.getPage(i);
+		if (page.terrain == nullptr || pageVersions[i] != page.version) {
+			continue;
+		}
+
+		glm::mat4 toWorld = glm::translate(glm::mat4(1), page.offset);
+		obj3D::Frustum frustum(projectionMatrix * viewMatrix * toWorld);
+		auto &groups = page.terrain->getObstacleGroups();
+
+		page.terrain->cull(frustum, [&](const obj3D::StaticItem &item) {
+			if (item.kind == obj3D::StaticItem::CHUNK) {
+				pageChunks[i].push_back(item.index);
+			} else {
+				visibleObstacles[item.group].push_back(toWorld * groups[item.group].matrices[item.index]);
+			}
+			stats.visible++;
+		});
+
+		nrItems += static_cast<unsigned int>(page.terrain->getStaticItems().size());
+	}
+
+	stats.culled = nrItems - stats.visible;
+	return stats;
+}
+
+void DroneGame::updatePages()
+{
+	if (!simulation.isStreaming()) {
+		return;
+	}
+
+	auto &streamer = simulation.getStreamer();
+
+	int uploads = 0;
+	for (int i = 0; i < STREAM_POOL_SIZE && uploads < STREAM_UPLOADS_PER_FRAME; i++) {
+		auto page = streamer.getPage(i);
+
+		if (page.terrain != nullptr && pageVersions[i] != page.version) {
+			pageMeshes[i].upload(page.terrain->getChunks(), counters);
+			pageVersions[i] = page.version;
+
+			uploads++;
+			minimapDirty = true;
+		}
+	}
+
+	// The minimap is centered on the origin
+	if (streamer.getOriginX() != pageOriginX || streamer.getOriginZ() != pageOriginZ) {
+		pageOriginX = streamer.getOriginX();
+		pageOriginZ = streamer.getOriginZ();
+		minimapDirty = true;
+	}
+}
+
+void DroneGame::renderTerrain(Shader *shader)
+{
+	if (!simulation.isStreaming()) {
+		glUniform3f(terrainOffsetLoc, 0, 0, 0);
+		counters->uniformUploads++;
+		terrainMeshes[frontMesh].render(renderQueue.getEye(), visibleChunks, counters);
+		return;
+	}
+
+	auto &streamer = simulation.getStreamer();
+
+	for (int i = 0; i < STREAM_POOL_SIZE; i++) {
+		if (pageChunks[i].empty()) {
+			continue;
+		}
+
+		glm::vec3 offset = streamer.getPage(i).offset;
+
+		glUniform3fv(terrainOffsetLoc, 1, glm::value_ptr(offset));
+		counters->uniformUploads++;
+		pageMeshes[i].render(renderQueue.getEye() - offset, pageChunks[i], counters);
+	}
 }
 
 DroneGame::DroneGame()
@@ -71,10 +538,24 @@ DroneGame::DroneGame()
 
 
 DroneGame::~DroneGame()
-{}
+{
+	simThread.stop();
+	recorder.close(simulation);
+}
 
 void DroneGame::addShaders()
 {
+	{
+		Shader *shader = new Shader("ColorShader");
+		shader->AddShader(PATH_JOIN(window->props.selfDir, SOURCE_PATH::M1,
+			"tema2", "shaders", "color/VertexShader.glsl"), GL_VERTEX_SHADER);
+		shader->AddShader(PATH_JOIN(window->props.selfDir, SOURCE_PATH::M1,
+			"tema2", "shaders", "color/FragmentShader.glsl"), GL_FRAGMENT_SHADER);
+
+		shader->CreateAndLink();
+		shaders[shader->GetName()] = shader;
+		shaderTable[SHADER_VERTEX_COLOR] = shader;
+	}
 	{
 		Shader *shader = new Shader("TerrainShader");
 		shader->AddShader(PATH_JOIN(window->props.selfDir, SOURCE_PATH::M1,
@@ -84,6 +565,9 @@ void DroneGame::addShaders()
 
 		shader->CreateAndLink();
 		shaders[shader->GetName()] = shader;
+		shaderTable[SHADER_TERRAIN] = shader;
+
+		terrainOffsetLoc = glGetUniformLocation(shader->program, "offset");
 	}
 	{
 		Shader *shader = new Shader("FOWShader");
@@ -94,6 +578,35 @@ void DroneGame::addShaders()
 
 		shader->CreateAndLink();
 		shaders[shader->GetName()] = shader;
+		shaderTable[SHADER_FOW] = shader;
+	}
+	{
+		Shader *shader = new Shader("ObstacleShader");
+		shader->AddShader(PATH_JOIN(window->props.selfDir, SOURCE_PATH::M1,
+			"tema2", "shaders", "obstacle/VertexShader.glsl"), GL_VERTEX_SHADER);
+		shader->AddShader(PATH_JOIN(window->props.selfDir, SOURCE_PATH::M1,
+			"tema2", "shaders", "obstacle/FragmentShader.glsl"), GL_FRAGMENT_SHADER);
+
+		shader->CreateAndLink();
+		shaders[shader->GetName()] = shader;
+		shaderTable[SHADER_OBSTACLE] = shader;
+	}
+	{
+		Shader *shader = new Shader("MinimapShader");
+		shader->AddShader(PATH_JOIN(window->props.selfDir, SOURCE_PATH::M1,
+			"tema2", "shaders", "minimap/VertexShader.glsl"), GL_VERTEX_SHADER);
+		shader->AddShader(PATH_JOIN(window->props.selfDir, SOURCE_PATH::M1,
+			"tema2", "shaders", "minimap/FragmentShader.glsl"), GL_FRAGMENT_SHADER);
+
+		shader->CreateAndLink();
+		shaders[shader->GetName()] = shader;
+		shaderTable[SHADER_MINIMAP] = shader;
+	}
+
+	// View, projection, drone position and fog of war come from the shared block
+	cameraBuffer.init();
+	for (Shader *shader : shaderTable) {
+		cameraBuffer.attach(shader);
 	}
 }
 
@@ -102,47 +615,68 @@ void DroneGame::addMeshes()
 	{
 		Mesh *mesh = obj3D::createRectangle("TerrainTile", glm::vec3(0), 1, 2, glm::vec3(0));
 		AddMeshToList(mesh);
+		meshTable[MESH_TERRAIN_TILE] = mesh;
 	}
 	{
-		Mesh *mesh = obj3D::Tree::createTree("Tree", glm::vec3(0), 1, 0.5f);
+		Mesh *mesh = obj3D::createTree("Tree", glm::vec3(0), 1, 0.5f);
 		AddMeshToList(mesh);
+		meshTable[MESH_TREE] = mesh;
+		instancedMeshes[MESH_TREE].init(mesh);
 	}
 	{
-		Mesh *mesh = obj3D::Building::createBuilding("Building", glm::vec3(0));
+		Mesh *mesh = obj3D::createBuilding("Building", glm::vec3(0));
 		AddMeshToList(mesh);
+		meshTable[MESH_BUILDING] = mesh;
+		instancedMeshes[MESH_BUILDING].init(mesh);
 	}
 	{
-		auto meshes = drone.createDroneMeshes("Base", "Blade", glm::vec3(0));
+		auto meshes = Drone::createDroneMeshes("Base", "Blade", glm::vec3(0));
 		AddMeshToList(meshes.first);
 		AddMeshToList(meshes.second);
+		meshTable[MESH_BASE] = meshes.first;
+		meshTable[MESH_BLADE] = meshes.second;
+		instancedMeshes[MESH_BASE].init(meshes.first);
+		instancedMeshes[MESH_BLADE].init(meshes.second);
 	}
 	{
 		Mesh *mesh = obj3D::createRectangleParallelepiped("Target", glm::vec3(0), 1, 1, 1, COLOR_RED);
 		AddMeshToList(mesh);
+		meshTable[MESH_TARGET] = mesh;
 	}
 	{
 		Mesh *mesh = obj3D::createRectangleParallelepiped("Delivery", glm::vec3(0), 1, 1, 1, COLOR_BLUE);
 		AddMeshToList(mesh);
+		meshTable[MESH_DELIVERY] = mesh;
 	}
 	{
 		Mesh *mesh = obj3D::createCone("Indicator", glm::vec3(0), 1, 1, COLOR_YELLOW);
 		AddMeshToList(mesh);
+		meshTable[MESH_INDICATOR] = mesh;
 	}
 }
 
 void DroneGame::Init()
 {
 	camera = nullptr;
-	speedFactor = 1.f;
 
 	window->DisablePointer();
-	fowShader = "VertexColor";
-
-	restart();
+	fow = false;
 
 	addMeshes();
 	addShaders();
 
+	// Optional, a missing or bad file keeps the defaults
+	sim::WorldConfig config;
+	if (config.load(PATH_JOIN(window->props.selfDir, WORLD_CONFIG_FILE))) {
+		setWorldConfig(config);
+	}
+
+	restart();
+
+	if (!replayPath.empty()) {
+		startReplay(replayPath);
+	}
+
 	textRenderer = gfxc::TextRenderer(window->props.selfDir, window->GetResolution().x, window->GetResolution().y);
 	textRenderer.Load(PATH_JOIN(window->props.selfDir, RESOURCE_PATH::FONTS, "Hack-Bold.ttf"), FONT_SIZE);
 }
@@ -150,6 +684,11 @@ void DroneGame::Init()
 
 void DroneGame::FrameStart()
 {
+	PROFILE_SCOPE(profiler, PHASE_FRAME_START);
+
+	updateRestart();
+	updatePages();
+
 	float viewX = window->props.resolution.x / 3.f;
 	float viewY = viewX / window->props.aspectRatio;
 
@@ -163,11 +702,8 @@ void DroneGame::FrameStart()
 		glClearColor(0.1f, 1.f, 0.1f, 1);
 		feedback--;
 	} else {
-		if (fowShader == "FOWShader") {
-			glClearColor(0.01f, 0.01f, 0.06f, 1);
-		} else {
-			glClearColor(0.3f, 0.3f, 0.8f, 1);
-		}
+		glm::vec3 color = fow ? COLOR_NIGHT_SKY : COLOR_SKY;
+		glClearColor(color.x, color.y, color.z, 1);
 	}
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
@@ -179,8 +715,10 @@ void DroneGame::FrameStart()
 
 void DroneGame::displayIndicator()
 {
-	auto targetPos = (drone.target == nullptr)
-		? terrain.target.pos : drone.target->sendPos;
+	auto &drone = view.drone;
+	auto &target = view.target;
+
+	auto targetPos = view.carrying ? target.sendPos : target.pos;
 	auto fwd = glm::normalize(targetPos - drone.pos);
 
 	float angle = atan2(fwd.x, fwd.z);
@@ -191,126 +729,332 @@ void DroneGame::displayIndicator()
 	modelMatrix = glm::rotate(modelMatrix, RADIANS(110), glm::vec3(1, 0, 0));
 	modelMatrix = glm::scale(modelMatrix, drone.size / 2.f * glm::vec3(0.5f, 2.5f, 0.5f));
 
-	RenderMesh(meshes["Indicator"], shaders["VertexColor"], modelMatrix);
+	renderQueue.push(SHADER_VERTEX_COLOR, MESH_INDICATOR, modelMatrix);
 }
 
-void DroneGame::updateShaders()
+void DroneGame::RenderScene(RenderPass pass)
 {
-	{
-		glUseProgram(shaders["TerrainShader"]->program);
+	float scale = (pass == PASS_MAIN) ? 1.f : 3.f;
+	ShaderId colorShader = fow ? SHADER_FOW : SHADER_VERTEX_COLOR;
 
-		auto loc = glGetUniformLocation(shaders["TerrainShader"]->program, "dronePos");
-		glUniform3fv(loc, 1, glm::value_ptr(drone.pos));
+	bool drawStatic = (pass != PASS_MINIMAP);
+	bool drawDynamic = (pass != PASS_MINIMAP_STATIC);
 
-		loc = glGetUniformLocation(shaders["TerrainShader"]->program, "fow");
-		glUniform1i(loc, fowShader == "FOWShader");
+	counters = &counting[pass];
 
-		glUseProgram(0);
+	cameraBuffer.update(viewMatrix, projectionMatrix, view.drone.pos, fow, counters);
+	renderQueue.begin(glm::vec3(glm::inverse(viewMatrix)[3]));
+
+	if (drawStatic) {
+		cullScene(pass);
+		pushStatic();
+	} else {
+		cullStats[pass] = CullStats();
 	}
-	{
-		glUseProgram(shaders["FOWShader"]->program);
 
-		auto loc = glGetUniformLocation(shaders["FOWShader"]->program, "dronePos");
-		glUniform3fv(loc, 1, glm::value_ptr(drone.pos));
+	if (drawDynamic) {
+		pushDynamic(pass, scale, colorShader);
+	}
+
+	submitQueue();
+
+	counters = &counting[NR_PASSES];
+
+	if (!enableUI || !drawDynamic) {
+		return;
+	}
+
+	PROFILE_SCOPE(profiler, PHASE_TEXT);
+
+	if (fow) {
+		textRenderer.RenderText("Score: " + std::to_string(view.score),
+			window->GetResolution().x * 9.f / 10.f, 1, 1);
+	} else {
+		textRenderer.RenderText("Score: " + std::to_string(view.score),
+			window->GetResolution().x * 9.f / 10.f, 1, 1, COLOR_BLACK);
+	}
+
+	if (showCounters && pass == PASS_MAIN) {
+		displayCounters(fow ? glm::vec3(1) : COLOR_BLACK);
+	}
+}
+
+/**
+ * Work of every pass in the last frame, under the score
+ */
+void DroneGame::displayCounters(const glm::vec3 &color)
+{
+	static const char *names[NR_PASSES + 1] = { "main", "minimap", "map cache", "other" };
+
+	float x = window->GetResolution().x * 6.f / 10.f;
+	float lineHeight = FONT_SIZE * 1.2f;
+
+	textRenderer.RenderText("pass       draws    tris progs unifs binds      KB", x, 1 + lineHeight, 1, color);
+
+	for (int i = 0; i <= NR_PASSES + 1; i++) {
+		const obj3D::RenderCounters &c = (i <= NR_PASSES) ? passCounters[i] : frameCounters;
+
+		char line[128];
+		std::snprintf(line, sizeof(line), "%-9s %6u %7llu %5u %5u %5u %7.1f",
+			(i <= NR_PASSES) ? names[i] : "frame", c.drawCalls, c.triangles,
+			c.programBinds, c.uniformUploads, c.bufferBinds, c.bytesUploaded / 1024.0);
 
-		glUseProgram(0);
+		textRenderer.RenderText(line, x, 1 + (i + 2) * lineHeight, 1, color);
+	}
+
+	if (swarm.size() > 0) {
+		auto &stats = swarm.getStats();
+
+		char line[128];
+		std::snprintf(line, sizeof(line), "swarm %zu drones, %.0fk drone-ticks/s, %llu deliveries",
+			swarm.size(), stats.droneTicksPerSecond() / 1000.0, stats.deliveries);
+
+		textRenderer.RenderText(line, x, 1 + (NR_PASSES + 4) * lineHeight, 1, color);
 	}
 }
 
-void DroneGame::RenderScene(float scale)
+void DroneGame::pushStatic()
 {
-	updateShaders();
+	if (fow && !simulation.isStreaming()) {
+		float sizeX = static_cast<float>(simulation.getTerrain().getSizeX());
+		float sizeZ = static_cast<float>(simulation.getTerrain().getSizeZ());
 
-	if (fowShader == "FOWShader") {
 		auto voidMatrix = glm::mat4(1);
-		voidMatrix = glm::translate(voidMatrix, glm::vec3(-MAP_SIZE_X * 2, -0.01f, -MAP_SIZE_Z * 2));
-		voidMatrix = glm::scale(voidMatrix, glm::vec3(MAP_SIZE_X * 2, 0, MAP_SIZE_Z * 4));
+		voidMatrix = glm::translate(voidMatrix, glm::vec3(-sizeX * 2, -0.01f, -sizeZ * 2));
+		voidMatrix = glm::scale(voidMatrix, glm::vec3(sizeX * 2, 0, sizeZ * 4));
+
+		renderQueue.push(SHADER_VERTEX_COLOR, MESH_TERRAIN_TILE, voidMatrix);
+	}
 
-		RenderMesh(meshes["TerrainTile"], shaders["VertexColor"], voidMatrix);
+	for (MeshId id : groupMeshes) {
+		if (id != NR_MESHES && instancedMeshes[id].getInstanceCount() > 0) {
+			renderQueue.pushInstanced(SHADER_OBSTACLE, id);
+		}
 	}
 
+	renderQueue.pushTerrain(SHADER_TERRAIN);
+}
+
+void DroneGame::pushDynamic(RenderPass pass, float scale, ShaderId colorShader)
+{
+	auto &drone = view.drone;
+	auto &target = view.target;
+
 	auto baseMatrix = drone.getBaseMatrix();
 	baseMatrix = glm::scale(baseMatrix, glm::vec3(scale));
-	RenderMesh(meshes["Base"], shaders["VertexColor"], baseMatrix);
+	renderQueue.push(SHADER_VERTEX_COLOR, MESH_BASE, baseMatrix);
 
 	for (auto &&bladeMatrix : drone.getBladeMatrices()) {
 		baseMatrix = glm::scale(baseMatrix, glm::vec3(scale));
-		RenderMesh(meshes["Blade"], shaders["VertexColor"], bladeMatrix);
+		renderQueue.push(SHADER_VERTEX_COLOR, MESH_BLADE, bladeMatrix);
 	}
 
-	auto obstacles = terrain.getObstacleData();
-	for (auto &&kv : obstacles) {
-		RenderMesh(meshes[kv.first], shaders[fowShader], kv.second);
+	// Too many to cull one by one, the GPU clips them
+	if (instancedMeshes[MESH_BASE].getInstanceCount() > 0) {
+		renderQueue.pushInstanced(SHADER_OBSTACLE, MESH_BASE);
+		renderQueue.pushInstanced(SHADER_OBSTACLE, MESH_BLADE);
 	}
 
-	auto tiles = terrain.getTileMatrices();
-	for (auto &&matrix : tiles) {
-		RenderMesh(meshes["TerrainTile"], shaders["TerrainShader"], matrix);
-	}
+	obj3D::Frustum frustum(projectionMatrix * viewMatrix);
+	auto targetBox = [scale](const glm::vec3 &pos, float size) {
+		return obj3D::AABB(pos - glm::vec3(size * scale), pos + glm::vec3(size * scale));
+	};
 
-	auto targetMatrix = glm::scale(terrain.target.getMatrix(), glm::vec3(scale));
-	RenderMesh(meshes["Target"], shaders[fowShader], targetMatrix);
+	auto targetMatrix = glm::scale(target.getMatrix(), glm::vec3(scale));
+	if (frustum.intersects(targetBox(target.pos, target.size))) {
+		renderQueue.push(colorShader, MESH_TARGET, targetMatrix);
+	}
 
-	if (drone.target != nullptr) {
-		auto deliverMatrix = glm::scale(drone.target->getDeliverMatrix(), glm::vec3(scale));
-		RenderMesh(meshes["Delivery"], shaders[fowShader], deliverMatrix);
+	if (view.carrying) {
+		auto deliverMatrix = glm::scale(target.getDeliverMatrix(), glm::vec3(scale));
+		if (frustum.intersects(targetBox(target.sendPos, target.size))) {
+			renderQueue.push(colorShader, MESH_DELIVERY, deliverMatrix);
+		}
 
 		if (enableUI) {
-			targetMatrix = glm::translate(drone.target->getDeliverMatrix(), glm::vec3(0, 50, 0));
+			targetMatrix = glm::translate(target.getDeliverMatrix(), glm::vec3(0, 50, 0));
 			targetMatrix = glm::scale(targetMatrix, glm::vec3(0.07f, 100.f, 0.07f));
 
-			RenderMesh(meshes["Delivery"], shaders["VertexColor"], targetMatrix);
+			renderQueue.push(SHADER_VERTEX_COLOR, MESH_DELIVERY, targetMatrix);
 		}
 	} else if (enableUI) {
-		targetMatrix = glm::translate(terrain.target.getMatrix(), glm::vec3(0, 50, 0));
+		targetMatrix = glm::translate(target.getMatrix(), glm::vec3(0, 50, 0));
 		targetMatrix = glm::scale(targetMatrix, glm::vec3(0.07f, 100.f, 0.07f));
 
-		RenderMesh(meshes["Target"], shaders["VertexColor"], targetMatrix);
+		renderQueue.push(SHADER_VERTEX_COLOR, MESH_TARGET, targetMatrix);
 	}
 
-	if (!enableUI) {
-		return;
+	if (pass == PASS_MAIN && enableUI) {
+		displayIndicator();
 	}
+}
 
-	if (fowShader == "FOWShader") {
-		textRenderer.RenderText("Score: " + std::to_string(score),
-			window->GetResolution().x * 9.f / 10.f, 1, 1);
-	} else {
-		textRenderer.RenderText("Score: " + std::to_string(score),
-			window->GetResolution().x * 9.f / 10.f, 1, 1, COLOR_BLACK);
+/**
+ * Programs are only bound when the shader changes, the camera comes
+ * from the uniform buffer and every draw only uploads its model matrix
+ */
+void DroneGame::submitQueue()
+{
+	renderQueue.sort();
+
+	Shader *current = nullptr;
+
+	for (auto &&item : renderQueue.getItems()) {
+		Shader *shader = shaderTable[item.shader];
+		if (!shader || !shader->program) {
+			continue;
+		}
+
+		if (shader != current) {
+			shader->Use();
+			current = shader;
+			counters->programBinds++;
+		}
+
+		switch (item.kind) {
+		case DrawItem::MESH:
+			if (meshTable[item.mesh] != nullptr) {
+				glUniformMatrix4fv(shader->loc_model_matrix, 1, GL_FALSE, glm::value_ptr(item.model));
+				meshTable[item.mesh]->Render();
+
+				counters->uniformUploads++;
+				countMesh(meshTable[item.mesh]);
+			}
+			break;
+		case DrawItem::INSTANCED:
+			instancedMeshes[item.mesh].render(counters);
+			break;
+		case DrawItem::TERRAIN:
+			renderTerrain(shader);
+			break;
+		}
 	}
 }
 
 void DroneGame::Update(float deltaTimeSeconds)
 {
-	RenderScene();
+	{
+		PROFILE_SCOPE(profiler, PHASE_RENDER_MAIN);
+		RenderScene();
+	}
 
 	if (!enableUI) {
 		return;
 	}
 
-	displayIndicator();
+	PROFILE_SCOPE(profiler, PHASE_RENDER_MINIMAP);
+
+	setMinimapCamera();
+	updateMinimapCache(deltaTimeSeconds);
 
 	glClear(GL_DEPTH_BUFFER_BIT);
 	glViewport(miniViewport.x, miniViewport.y, miniViewport.width, miniViewport.height);
 
+	minimapCache.draw(shaderTable[SHADER_MINIMAP], &counting[PASS_MINIMAP]);
+	RenderScene(PASS_MINIMAP);
+}
+
+void DroneGame::setMinimapCamera()
+{
 	glm::vec3 topDownPosition = glm::vec3(0, 25.f, 0);
 	glm::vec3 topDownTarget = glm::vec3(0, 0, 0);
 	glm::vec3 upDirection = glm::vec3(0, 0, -1);
 
 	glm::mat4 topDownView = glm::lookAt(topDownPosition, topDownTarget, upDirection);
-	glm::mat4 orthoProjection = glm::ortho(-MAP_SIZE_X / 2.f, MAP_SIZE_X / 2.f,
-		-MAP_SIZE_Z / 2.f, MAP_SIZE_Z / 2.f, 0.1f, 100.0f);
+	// The whole world, or the configured size around the origin when streaming
+	const sim::WorldConfig &world = simulation.getWorldConfig();
+	glm::vec2 mapSize(world.sizeX, world.sizeZ);
+
+	glm::mat4 orthoProjection = glm::ortho(-mapSize.x / 2.f, mapSize.x / 2.f,
+		-mapSize.y / 2.f, mapSize.y / 2.f, 0.1f, 100.0f);
 
 	viewMatrix = topDownView;
 	projectionMatrix = orthoProjection;
+}
+
+/**
+ * Terrain, trees and buildings are only redrawn into the cache after
+ * a restart, a fog of war toggle, a resize, or when the refresh is due
+ */
+void DroneGame::updateMinimapCache(float deltaTime)
+{
+	minimapAge += deltaTime;
 
-	RenderScene(3.f);
+	if (minimapCache.resize(miniViewport.width, miniViewport.height)) {
+		minimapDirty = true;
+	}
+
+	float refresh = fow ? MINIMAP_FOW_REFRESH : minimapRefresh;
+	if (!minimapDirty && (refresh <= 0 || minimapAge < refresh)) {
+		return;
+	}
+
+	minimapCache.begin(fow ? COLOR_NIGHT_SKY : COLOR_SKY);
+	RenderScene(PASS_MINIMAP_STATIC);
+	minimapCache.end();
+
+	minimapDirty = false;
+	minimapAge = 0;
 }
 
 
 void DroneGame::FrameEnd()
-{}
+{
+	if (showProfiler) {
+		displayProfiler();
+	}
+
+	profiler.endFrame();
+	rollCounters();
+}
+
+void DroneGame::rollCounters()
+{
+	frameCounters = obj3D::RenderCounters();
+
+	for (int i = 0; i <= NR_PASSES; i++) {
+		passCounters[i] = counting[i];
+		frameCounters += counting[i];
+		counting[i] = obj3D::RenderCounters();
+	}
+}
+
+/**
+ * The framework meshes bind their vertex array and draw it whole
+ */
+void DroneGame::countMesh(const Mesh *mesh)
+{
+	counters->bufferBinds++;
+	counters->draw((mesh->GetDrawMode() == GL_TRIANGLES) ? mesh->indices.size() / 3 : 0);
+}
+
+/**
+ * Rolling percentiles of every phase, in milliseconds
+ */
+void DroneGame::displayProfiler()
+{
+	PROFILE_SCOPE(profiler, PHASE_TEXT);
+
+	glm::ivec2 resolution = window->GetResolution();
+	glViewport(0, 0, resolution.x, resolution.y);
+
+	glm::vec3 color = fow ? glm::vec3(1) : COLOR_BLACK;
+	float lineHeight = FONT_SIZE * 1.2f;
+
+	textRenderer.RenderText("phase          cpu p50   p95   p99   gpu p50   p95   p99", 10, 10, 1, color);
+
+	for (int i = 0; i < NR_PHASES; i++) {
+		auto phase = static_cast<ProfilePhase>(i);
+		auto cpu = profiler.getCpuPercentiles(phase);
+		auto gpu = profiler.getGpuPercentiles(phase);
+
+		char line[128];
+		std::snprintf(line, sizeof(line), "%-14s %7.2f %5.2f %5.2f %9.2f %5.2f %5.2f",
+			phaseName(phase), cpu.p50, cpu.p95, cpu.p99, gpu.p50, gpu.p95, gpu.p99);
+
+		textRenderer.RenderText(line, 10, 10 + (i + 1) * lineHeight, 1, color);
+	}
+}
 
 
 void DroneGame::RenderMesh(Mesh *mesh, Shader *shader, const glm::mat4 &modelMatrix)
@@ -325,6 +1069,10 @@ void DroneGame::RenderMesh(Mesh *mesh, Shader *shader, const glm::mat4 &modelMat
 	glUniformMatrix4fv(shader->loc_model_matrix, 1, GL_FALSE, glm::value_ptr(modelMatrix));
 
 	mesh->Render();
+
+	counters->programBinds++;
+	counters->uniformUploads += 3;
+	countMesh(mesh);
 }
 
 
@@ -333,163 +1081,149 @@ void DroneGame::RenderMesh(Mesh *mesh, Shader *shader, const glm::mat4 &modelMat
  *  how they behave, see `input_controller.h`.
  */
 
-glm::vec3 DroneGame::keepInBounds(glm::vec3 pos)
+sim::InputState DroneGame::readInput() const
 {
-	glm::vec3 res;
-
-	res.x = std::max(-MAP_SIZE_X / 2.f, pos.x);
-	res.x = std::min(MAP_SIZE_X / 2.f, res.x);
-
-	res.z = std::max(-MAP_SIZE_Z / 2.f, pos.z);
-	res.z = std::min(MAP_SIZE_Z / 2.f, res.z);
+	sim::InputState input;
 
-	float droneRY = drone.size * DRONE_h * 1.5f / 2.f;
-	if (drone.target != nullptr) {
-		droneRY += drone.target->size / 1.5f;
-	}
-
-	res.y = std::max(terrain.getTerrainY(res.x, res.z)
-		+ droneRY + 0.05f, res.y);
-	res.y = std::min(static_cast<float>(MAP_SIZE_Y), res.y);
+	input.forward = window->KeyHold(GLFW_KEY_W);
+	input.backward = window->KeyHold(GLFW_KEY_S);
+	input.right = window->KeyHold(GLFW_KEY_D);
+	input.left = window->KeyHold(GLFW_KEY_A);
+	input.up = window->KeyHold(GLFW_KEY_LEFT_SHIFT);
+	input.down = window->KeyHold(GLFW_KEY_LEFT_CONTROL);
 
-	return res;
-}
+	input.rotateLeft = window->KeyHold(GLFW_KEY_Q);
+	input.rotateRight = window->KeyHold(GLFW_KEY_E);
 
-void DroneGame::moveForward(float distance)
-{
-	auto dVec = camera->forward;
-	dVec.y = 0;
-	dVec = glm::normalize(dVec);
+	input.boost = window->KeyHold(GLFW_KEY_SPACE);
 
-	auto oldPos = drone.pos;
-	drone.pos = keepInBounds(drone.pos + distance * dVec);
+	input.forwardDir = camera->forward;
+	input.rightDir = camera->right;
 
-	checkPosHit(oldPos);
+	return input;
 }
 
-void DroneGame::moveRight(float distance)
+void DroneGame::OnInputUpdate(float deltaTime, int mods)
 {
-	auto dVec = camera->right;
-
-	auto oldPos = drone.pos;
-	drone.pos = keepInBounds(drone.pos + distance * dVec);
+	PROFILE_SCOPE(profiler, PHASE_INPUT);
 
-	checkPosHit(oldPos);
-}
+	sim::InputState input;
+	if (replaying) {
+		if (!replayEvents(input, deltaTime)) {
+			return;
+		}
+	} else {
+		input = readInput();
+		recorder.frame(input, deltaTime);
+	}
 
-void DroneGame::moveUp(float distance)
-{
-	auto dVec = glm::vec3(0, 1, 0);
+	if (simThread.isRunning()) {
+		simThread.pushInput(input);
+		view = simThread.sample();
+	} else {
+		simulation.advance(input, deltaTime);
+		view = sim::makeSnapshot(simulation);
+	}
 
-	auto oldPos = drone.pos;
-	drone.pos = keepInBounds(drone.pos + 1.2f * distance * dVec);
+	// The camera follows the drone
+	camera->position += view.drone.pos - followPos;
+	if (fstPerson) {
+		camera->RotateThirdPerson_OY(view.drone.angle - followAngle);
+	}
 
-	checkPosHit(oldPos);
-}
+	followPos = view.drone.pos;
+	followAngle = view.drone.angle;
 
-void DroneGame::checkPosHit(glm::vec3 oldPos)
-{
-	glm::vec3 dVec = drone.pos - oldPos;
-	if (terrain.hit(drone)) {
-		drone.pos -= dVec * 1.2f;
+	if (view.deliveries != deliveries) {
+		deliveries = view.deliveries;
+		feedback = 15;
 	}
-	camera->position += drone.pos - oldPos;
+
+	updateSwarm(deltaTime);
 }
 
-void DroneGame::moveInput(float deltaTime)
+void DroneGame::OnKeyPress(int key, int mods)
 {
-	float step = deltaTime * 3.f;
-	float dAngle = deltaTime * 15;
-
-	// Move
-	if (window->KeyHold(GLFW_KEY_W)) {
-		moveForward(step);
-		dAngle = deltaTime * 25;
-	} else if (window->KeyHold(GLFW_KEY_S)) {
-		moveForward(-step);
-		dAngle = deltaTime * 25;
+	// The keys of the trace are replayed instead, only the overlays stay usable
+	if (replaying && key != GLFW_KEY_F2 && key != GLFW_KEY_F3 && key != GLFW_KEY_F4
+		&& key != GLFW_KEY_F6) {
+		return;
 	}
 
-	if (window->KeyHold(GLFW_KEY_D)) {
-		moveRight(step);
-		dAngle = deltaTime * 25;
-	} else if (window->KeyHold(GLFW_KEY_A)) {
-		moveRight(-step);
-		dAngle = deltaTime * 25;
+	// A recording in progress is ended first, and replayed right away
+	if (key == GLFW_KEY_F6) {
+		if (replaying) {
+			endReplay(nullptr);
+		} else if (!startReplay(PATH_JOIN(window->props.selfDir, INPUT_TRACE_FILE))) {
+			std::printf("replay: no trace to replay in %s\n", INPUT_TRACE_FILE);
+		}
+		return;
 	}
 
-	if (window->KeyHold(GLFW_KEY_LEFT_SHIFT)) {
-		moveUp(step);
-		dAngle = deltaTime * 25;
-	} else if (window->KeyHold(GLFW_KEY_LEFT_CONTROL)) {
-		moveUp(-step);
-		dAngle = deltaTime * 25;
+	if (key == GLFW_KEY_F5) {
+		if (recorder.isOpen()) {
+			stopRecording();
+		} else {
+			startRecording(PATH_JOIN(window->props.selfDir, INPUT_TRACE_FILE));
+		}
+		return;
 	}
 
-	drone.bladeAngle += dAngle;
+	recorder.key(key, mods);
+	handleKey(key, mods);
 }
 
-void DroneGame::OnInputUpdate(float deltaTime, int mods)
+/**
+ * Worlds are restarted by the trace itself while replaying
+ */
+void DroneGame::handleKey(int key, int mods)
 {
-	speedFactor = 1.f;
-	if (window->KeyHold(GLFW_KEY_SPACE)) {
-		speedFactor = MAP_SIZE_Y / 5.f;
-	}
-
-	deltaTime *= speedFactor;
-
-	moveInput(deltaTime);
-
-	// Rotate
-	float angleStep = deltaTime * 1.5f;
-
-	if (window->KeyHold(GLFW_KEY_Q)) {
-		drone.angle += angleStep;
-		if (fstPerson) {
-			camera->RotateThirdPerson_OY(angleStep);
-		}
-	} else if (window->KeyHold(GLFW_KEY_E)) {
-		drone.angle -= angleStep;
-		if (fstPerson) {
-			camera->RotateThirdPerson_OY(-angleStep);
+	if (key == GLFW_KEY_R) {
+		if (!replaying) {
+			requestRestart();
 		}
+		return;
 	}
 
-	drone.acquireTarget(terrain.target);
-	if (drone.target != nullptr && drone.target->deliver()) {
-		score += floor(drone.target->distance);
+	if (key == GLFW_KEY_F2) {
+		showCounters = !showCounters;
+	}
 
-		feedback = 15;
+	if (key == GLFW_KEY_F3) {
+		showProfiler = !showProfiler;
+		profiler.setEnabled(showProfiler);
+	}
 
-		drone.target = nullptr;
-		terrain.generateTarget();
+	if (key == GLFW_KEY_F4 && profiler.isEnabled()) {
+		profiler.exportTrace(PATH_JOIN(window->props.selfDir, PROFILER_TRACE_FILE));
 	}
-}
 
-void DroneGame::OnKeyPress(int key, int mods)
-{
-	// Add key press event
-	if (key == GLFW_KEY_R) {
-		restart();
+	if (key == GLFW_KEY_I) {
+		if (!replaying) {
+			streaming = !streaming;
+			restart();
+		}
 		return;
 	}
 
+	if (key == GLFW_KEY_K) {
+		swarmSize = (swarmSize > 0) ? 0 : SWARM_DEFAULT_SIZE;
+		resetSwarm();
+	}
+
 	if (key == GLFW_KEY_TAB) {
 		fstPerson = !fstPerson;
 
 		if (fstPerson) {
-			makeFirstPerson(camera, drone.pos);
+			makeFirstPerson(camera, view.drone.pos);
 		} else {
-			makeThirdPerson(camera, drone.pos);
+			makeThirdPerson(camera, view.drone.pos);
 		}
 	}
 
 	if (key == GLFW_KEY_F) {
-		if (fowShader == "FOWShader") {
-			fowShader = "VertexColor";
-		} else {
-			fowShader = "FOWShader";
-		}
+		fow = !fow;
+		minimapDirty = true;
 	}
 
 	if (key == GLFW_KEY_P) {
@@ -510,7 +1244,16 @@ void DroneGame::OnKeyRelease(int key, int mods)
 
 void DroneGame::OnMouseMove(int mouseX, int mouseY, int deltaX, int deltaY)
 {
-	// Add mouse move event
+	if (replaying) {
+		return;
+	}
+
+	recorder.mouse(deltaX, deltaY);
+	rotateCamera(deltaX, deltaY);
+}
+
+void DroneGame::rotateCamera(int deltaX, int deltaY)
+{
 	float sensivityOX = 0.001f;
 	float sensivityOY = 0.001f;
 
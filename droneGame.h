@@ -4,8 +4,20 @@
 #include "components/text_renderer.h"
 
 #include "lab_m1/tema2/gameCamera.h"
+#include "lab_m1/tema2/renderQueue.h"
+#include "lab_m1/tema2/cameraBuffer.h"
+#include "lab_m1/tema2/minimapCache.h"
+#include "lab_m1/tema2/frameProfiler.h"
+#include "lab_m1/tema2/sim/simulation.h"
+#include "lab_m1/tema2/sim/inputTrace.h"
+#include "lab_m1/tema2/sim/simulationThread.h"
+#include "lab_m1/tema2/sim/swarm.h"
+#include "lab_m1/tema2/color.h"
 #include "3D/objects.h"
+#include "3D/instancedMesh.h"
+#include "3D/renderCounters.h"
 #include "3D/assets/terrain/terrain.h"
+#include "3D/assets/terrain/terrainMesh.h"
 #include "3D/assets/drone/drone.h"
 
 using obj3D::Drone;
@@ -18,6 +30,149 @@ namespace m1 {
 
 		void Init() override;
 
+		/**
+		 * The minimap is split into a cached static layer
+		 * and the dynamic objects drawn over it every frame
+		 */
+		enum RenderPass { PASS_MAIN, PASS_MINIMAP, PASS_MINIMAP_STATIC, NR_PASSES };
+
+		struct CullStats {
+			unsigned int visible = 0;
+			unsigned int culled = 0;
+		};
+
+		/**
+		 * Static items kept and dropped by frustum culling in the last @a pass
+		 */
+		inline const CullStats &getCullStats(RenderPass pass) const
+		{
+			return cullStats[pass];
+		}
+
+		/**
+		 * GL work of @a pass over the last complete frame
+		 */
+		inline const obj3D::RenderCounters &getRenderCounters(RenderPass pass) const
+		{
+			return passCounters[pass];
+		}
+
+		/**
+		 * All the GL work of the last complete frame, the uploads made
+		 * between the passes included. Text rendering is not counted
+		 */
+		inline const obj3D::RenderCounters &getFrameCounters() const
+		{
+			return frameCounters;
+		}
+
+		/**
+		 * Seconds between forced redraws of the minimap static layer,
+		 * 0 to only redraw it when the world changes
+		 */
+		inline void setMinimapRefresh(float seconds)
+		{
+			minimapRefresh = seconds;
+		}
+
+		/**
+		 * Seed of every generated world, 0 picks a new random one on each restart
+		 */
+		inline void setWorldSeed(unsigned int seed)
+		{
+			worldSeed = seed;
+		}
+
+		/**
+		 * Size and density of the worlds generated from the next restart
+		 * on. Init() reads it from tema2_world.cfg next to the executable,
+		 * if there is one, see sim::WorldConfig::load()
+		 */
+		void setWorldConfig(const sim::WorldConfig &config);
+
+		/**
+		 * Restarts load the world from @a path, and write it there
+		 * first if it does not exist yet. Empty to always generate
+		 */
+		inline void setSnapshotPath(const std::string &path)
+		{
+			snapshotPath = path;
+		}
+
+		/**
+		 * Builds and uploads the next world in the background as soon as
+		 * the current one starts, so that a restart swaps it in right away
+		 */
+		inline void setPregenerate(bool enable)
+		{
+			pregenerate = enable;
+		}
+
+		/**
+		 * Plays in an endless world streamed around the drone
+		 * instead of a fixed one, from the next restart on
+		 */
+		inline void setStreaming(bool enable)
+		{
+			streaming = enable;
+		}
+
+		/**
+		 * Steps the simulation on a thread of its own at a fixed rate, the
+		 * frames drawing it interpolated one tick in the past. Streamed
+		 * worlds, recordings and replays always step it on the frame thread
+		 */
+		inline void setThreadedSimulation(bool enable)
+		{
+			threadedSimulation = enable;
+		}
+
+		inline sim::SimulationThread::Stats getSimulationStats() const
+		{
+			return simThread.getStats();
+		}
+
+		/**
+		 * Records the input of every frame to @a path, starting over in a
+		 * new world so that the trace can be replayed from its start
+		 */
+		bool startRecording(const std::string &path);
+		void stopRecording();
+
+		/**
+		 * Flies the game along a trace written by startRecording() instead
+		 * of reading the controls, one recorded frame per frame. F6 replays
+		 * the trace of F5. Takes effect in Init() if set before. At the end,
+		 * prints whether the replay matched the recording and the frame
+		 * times along the way
+		 */
+		bool startReplay(const std::string &path);
+
+		inline void setReplayPath(const std::string &path)
+		{
+			replayPath = path;
+		}
+
+		inline bool isReplaying() const
+		{
+			return replaying;
+		}
+
+		/**
+		 * Autonomous drones flying deliveries around the player, 0 for none,
+		 * from the next restart on. Only in fixed worlds, K switches
+		 * SWARM_DEFAULT_SIZE of them on and off right away
+		 */
+		inline void setSwarmSize(size_t count)
+		{
+			swarmSize = count;
+		}
+
+		inline const sim::Swarm::Stats &getSwarmStats() const
+		{
+			return swarm.getStats();
+		}
+
 	private:
 		struct ViewportArea {
 			ViewportArea() : x(0), y(0), width(1), height(1) {}
@@ -45,25 +200,77 @@ namespace m1 {
 		void OnMouseScroll(int mouseX, int mouseY, int offsetX, int offsetY) override;
 		void OnWindowResize(int width, int height) override;
 
-		void RenderScene(float scale = 1.f);
+		void RenderScene(RenderPass pass = PASS_MAIN);
+		void cullScene(RenderPass pass);
+		CullStats cullPages();
+		void renderTerrain(Shader *shader);
+		void pushStatic();
+		void pushDynamic(RenderPass pass, float scale, ShaderId colorShader);
+		void submitQueue();
 
-		void moveInput(float deltaTime);
+		void setMinimapCamera();
+		void updateMinimapCache(float deltaTime);
+
+		/**
+		 * Controls held this frame, moving relative to the camera
+		 */
+		sim::InputState readInput() const;
 
 		void addShaders();
 		void addMeshes();
 
-		void moveForward(float distance);
-		void moveRight(float distance);
-		void moveUp(float distance);
-
+		/**
+		 * Blocks until the world is ready, only used for the first one
+		 */
 		void restart();
 
-		void checkPosHit(glm::vec3 oldPos);
+		/**
+		 * Restarts in a world built on another thread and uploaded over
+		 * several frames, the current one is played until then
+		 */
+		void requestRestart();
+		void updateRestart();
+		void dropNextWorld();
+
+		unsigned int pickSeed() const;
+		void startWorld();
+		void uploadTerrain();
+
+		/**
+		 * Uploads the streamed pages generated since the last
+		 * frame, STREAM_UPLOADS_PER_FRAME at most
+		 */
+		void updatePages();
+
+		/**
+		 * Runs the simulation thread whenever it can be used, it must be
+		 * stopped before anything but the thread touches the simulation
+		 */
+		void updateSimThread();
+
+		bool replayEvents(sim::InputState &input, float &deltaTime);
+		void replayWorld(const sim::TraceEvent &event);
+		void endReplay(const sim::TraceEnd *expected);
+
+		/**
+		 * The swarm follows the simulation into every new world
+		 */
+		void resetSwarm();
+		void updateSwarm(float deltaTime);
+		void uploadSwarm();
+
+		void handleKey(int key, int mods);
+		void rotateCamera(int deltaX, int deltaY);
 
 		void displayIndicator();
+		void displayProfiler();
+		void displayCounters(const glm::vec3 &color);
 
-		glm::vec3 keepInBounds(glm::vec3 pos);
-		void updateShaders();
+		/**
+		 * Keeps the counts of the frame that just ended and starts over
+		 */
+		void rollCounters();
+		void countMesh(const Mesh *mesh);
 
 	protected:
 		implemented::GameCamera *camera;
@@ -74,17 +281,88 @@ namespace m1 {
 
 		ViewportArea miniViewport;
 
-		obj3D::Terrain terrain;
+		sim::Simulation simulation;
+		int deliveries;
+
+		// Stopped before the simulation is destroyed
+		bool threadedSimulation = true;
+		sim::SimulationThread simThread;
+
+		// The state drawn this frame, and the one the camera last followed
+		sim::SimSnapshot view;
+		glm::vec3 followPos;
+		float followAngle = 0;
+
+		unsigned int worldSeed = 0;
+		std::string snapshotPath;
+
+		// The one drawn, and the one the next world is uploaded to
+		obj3D::TerrainMesh terrainMeshes[2];
+		int frontMesh = 0;
+
+		bool pregenerate = false;
+		bool restartRequested = false;
+		bool uploadingNext = false;
+
+		// One mesh per slot of the streamer pool, and the page version it holds
+		bool streaming = false;
+		obj3D::TerrainMesh pageMeshes[STREAM_POOL_SIZE];
+		unsigned int pageVersions[STREAM_POOL_SIZE] = {};
+		std::vector<unsigned int> pageChunks[STREAM_POOL_SIZE];
+		long long pageOriginX = 0;
+		long long pageOriginZ = 0;
+		GLint terrainOffsetLoc = -1;
+
+		obj3D::InstancedMesh instancedMeshes[NR_MESHES];
+
+		// Mesh of every obstacle group of the terrain
+		std::vector<MeshId> groupMeshes;
+
+		Mesh *meshTable[NR_MESHES] = {};
+		Shader *shaderTable[NR_SHADERS] = {};
+
+		RenderQueue renderQueue;
+		CameraBuffer cameraBuffer;
+
+		MinimapCache minimapCache;
+		bool minimapDirty = true;
+		float minimapAge = 0;
+		float minimapRefresh = 0;
+
+		// Drawn with one instanced call for the bases and one for the blades
+		size_t swarmSize = 0;
+		sim::Swarm swarm;
+		obj3D::ThreadPool swarmPool;
+		std::vector<glm::mat4> swarmBases;
+		std::vector<glm::mat4> swarmBlades;
+
+		// F5 starts and stops recording
+		sim::TraceWriter recorder;
+		sim::TraceReader replay;
+		std::string replayPath;
+		bool replaying = false;
+		sim::FrameTimes replayTimes;
+
+		// Toggled with F3, F4 writes the trace
+		FrameProfiler profiler;
+		bool showProfiler = false;
+
+		// Toggled with F2. Work outside the passes is counted in the last slot
+		bool showCounters = false;
+		obj3D::RenderCounters counting[NR_PASSES + 1];
+		obj3D::RenderCounters passCounters[NR_PASSES + 1];
+		obj3D::RenderCounters frameCounters;
+		obj3D::RenderCounters *counters = &counting[NR_PASSES];
 
-		Drone drone;
-		float speedFactor;
+		CullStats cullStats[NR_PASSES];
+		std::vector<unsigned int> visibleChunks;
+		std::vector<std::vector<glm::mat4>> visibleObstacles;
 
-		std::string fowShader;
+		bool fow;
 
 		bool enableUI;
 
 		gfxc::TextRenderer textRenderer;
 		int feedback;
-		int score;
 	};
 }   // namespace m1
@@ -0,0 +1,297 @@
+#include "lab_m1/tema2/frameProfiler.h"
+
+#include <cstdio>
+#include <algorithm>
+
+using namespace m1;
+
+const char *m1::phaseName(ProfilePhase phase)
+{
+	static const char *names[NR_PHASES] = {
+		"FrameStart",
+		"Input",
+		"RenderMain",
+		"RenderMinimap",
+		"Text",
+	};
+
+	return names[phase];
+}
+
+FrameProfiler::FrameProfiler()
+	: epoch(std::chrono::steady_clock::now()), history(PROFILER_HISTORY)
+{}
+
+FrameProfiler::~FrameProfiler()
+{
+	for (auto &&gpu : gpuFrames) {
+		if (!gpu.queries.empty()) {
+			glDeleteQueries(static_cast<GLsizei>(gpu.queries.size()), gpu.queries.data());
+		}
+	}
+}
+
+double FrameProfiler::now() const
+{
+	return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - epoch).count();
+}
+
+void FrameProfiler::setEnabled(bool enable)
+{
+	if (enable == enabled) {
+		return;
+	}
+	enabled = enable;
+
+	if (!enabled) {
+		return;
+	}
+
+	// Starts over, the frames before were not recorded
+	depth = 0;
+	overflow = 0;
+	firstFrame = frameIndex;
+
+	Frame &frame = current();
+	frame = Frame();
+	frame.index = frameIndex;
+	frame.startUs = now();
+
+	for (auto &&gpu : gpuFrames) {
+		gpu.used = 0;
+		gpu.pending = false;
+	}
+}
+
+void FrameProfiler::beginQuery(ProfilePhase phase)
+{
+	GpuFrame &gpu = gpuFrames[gpuSlot];
+
+	if (gpu.used == gpu.queries.size()) {
+		GLuint query = 0;
+		glGenQueries(1, &query);
+
+		gpu.queries.push_back(query);
+		gpu.phases.push_back(phase);
+	} else {
+		gpu.phases[gpu.used] = phase;
+	}
+
+	glBeginQuery(GL_TIME_ELAPSED, gpu.queries[gpu.used]);
+	gpu.used++;
+}
+
+void FrameProfiler::endQuery()
+{
+	glEndQuery(GL_TIME_ELAPSED);
+}
+
+void FrameProfiler::begin(ProfilePhase phase)
+{
+	if (depth == PROFILER_MAX_DEPTH) {
+		overflow++;
+		return;
+	}
+
+	// Only one query can run at a time
+	if (depth > 0) {
+		endQuery();
+	}
+
+	stack[depth] = phase;
+	stackStart[depth] = now();
+	depth++;
+
+	beginQuery(phase);
+}
+
+void FrameProfiler::end()
+{
+	if (overflow > 0) {
+		overflow--;
+		return;
+	}
+	if (depth == 0) {
+		return;
+	}
+
+	depth--;
+	endQuery();
+
+	ProfilePhase phase = stack[depth];
+	double start = stackStart[depth];
+	double duration = now() - start;
+
+	Frame &frame = current();
+	frame.cpuMs[phase] += static_cast<float>(duration / 1000.0);
+
+	if (frame.nrEvents < PROFILER_MAX_EVENTS) {
+		frame.events[frame.nrEvents++] = { phase, start, duration };
+	}
+
+	if (depth > 0) {
+		beginQuery(stack[depth - 1]);
+	}
+}
+
+/**
+ * Reads the queries of @a gpu if the last one is done, they finish in order
+ */
+void FrameProfiler::collect(GpuFrame &gpu)
+{
+	if (!gpu.pending) {
+		return;
+	}
+
+	GLint available = 0;
+	glGetQueryObjectiv(gpu.queries[gpu.used - 1], GL_QUERY_RESULT_AVAILABLE, &available);
+	if (!available) {
+		return;
+	}
+
+	gpu.pending = false;
+
+	Frame &frame = history[gpu.frame % PROFILER_HISTORY];
+	if (frame.index != gpu.frame) {
+		return;
+	}
+
+	for (size_t i = 0; i < gpu.used; i++) {
+		GLuint64 ns = 0;
+		glGetQueryObjectui64v(gpu.queries[i], GL_QUERY_RESULT, &ns);
+
+		frame.gpuMs[gpu.phases[i]] += static_cast<float>(ns / 1e6);
+	}
+	frame.gpuValid = true;
+}
+
+void FrameProfiler::endFrame()
+{
+	if (!enabled) {
+		return;
+	}
+
+	double t = now();
+	current().durUs = t - current().startUs;
+
+	GpuFrame &gpu = gpuFrames[gpuSlot];
+	gpu.frame = frameIndex;
+	gpu.pending = (gpu.used > 0);
+
+	gpuSlot = (gpuSlot + 1) % PROFILER_GPU_LATENCY;
+
+	for (int i = 0; i < PROFILER_GPU_LATENCY; i++) {
+		collect(gpuFrames[(gpuSlot + i) % PROFILER_GPU_LATENCY]);
+	}
+
+	// Still not done after PROFILER_GPU_LATENCY frames, dropped rather than waited for
+	gpuFrames[gpuSlot].pending = false;
+	gpuFrames[gpuSlot].used = 0;
+
+	frameIndex++;
+
+	Frame &next = current();
+	next = Frame();
+	next.index = frameIndex;
+	next.startUs = t;
+}
+
+FrameProfiler::Percentiles FrameProfiler::percentiles(ProfilePhase phase, bool gpu) const
+{
+	std::vector<float> values;
+
+	unsigned long long first = std::max(firstFrame,
+		(frameIndex >= PROFILER_HISTORY) ? frameIndex - PROFILER_HISTORY + 1 : 0);
+
+	// The frame being recorded is not complete
+	for (unsigned long long i = first; i < frameIndex; i++) {
+		const Frame &frame = history[i % PROFILER_HISTORY];
+
+		if (frame.index == i && (!gpu || frame.gpuValid)) {
+			values.push_back(gpu ? frame.gpuMs[phase] : frame.cpuMs[phase]);
+		}
+	}
+
+	Percentiles res;
+	if (values.empty()) {
+		return res;
+	}
+
+	std::sort(values.begin(), values.end());
+
+	auto at = [&values](float q) {
+		return values[static_cast<size_t>(q * (values.size() - 1) + 0.5f)];
+	};
+
+	res.p50 = at(0.50f);
+	res.p95 = at(0.95f);
+	res.p99 = at(0.99f);
+
+	return res;
+}
+
+FrameProfiler::Percentiles FrameProfiler::getCpuPercentiles(ProfilePhase phase) const
+{
+	return percentiles(phase, false);
+}
+
+FrameProfiler::Percentiles FrameProfiler::getGpuPercentiles(ProfilePhase phase) const
+{
+	return percentiles(phase, true);
+}
+
+bool FrameProfiler::exportTrace(const std::string &path) const
+{
+	FILE *out = std::fopen(path.c_str(), "w");
+	if (out == nullptr) {
+		return false;
+	}
+
+	std::fprintf(out, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+	std::fprintf(out, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"CPU\"}},\n");
+	std::fprintf(out, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":2,\"args\":{\"name\":\"GPU\"}}");
+
+	auto slice = [out](const char *name, int tid, double ts, double dur) {
+		std::fprintf(out, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+			name, tid, ts, dur);
+	};
+
+	unsigned long long first = std::max(firstFrame,
+		(frameIndex >= PROFILER_HISTORY) ? frameIndex - PROFILER_HISTORY + 1 : 0);
+
+	for (unsigned long long i = first; i < frameIndex; i++) {
+		const Frame &frame = history[i % PROFILER_HISTORY];
+		if (frame.index != i) {
+			continue;
+		}
+
+		slice("Frame", 1, frame.startUs, frame.durUs);
+
+		for (int e = 0; e < frame.nrEvents; e++) {
+			const Event &event = frame.events[e];
+			slice(phaseName(event.phase), 1, event.startUs, event.durUs);
+		}
+
+		if (!frame.gpuValid) {
+			continue;
+		}
+
+		for (int phase = 0; phase < NR_PHASES; phase++) {
+			// Started with the first scope of the phase
+			const Event *start = nullptr;
+			for (int e = 0; e < frame.nrEvents && start == nullptr; e++) {
+				if (frame.events[e].phase == phase) {
+					start = &frame.events[e];
+				}
+			}
+
+			if (start != nullptr && frame.gpuMs[phase] > 0) {
+				slice(phaseName(static_cast<ProfilePhase>(phase)), 2, start->startUs, frame.gpuMs[phase] * 1000.0);
+			}
+		}
+	}
+
+	std::fprintf(out, "\n]}\n");
+
+	return std::fclose(out) == 0;
+}
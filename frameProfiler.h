@@ -0,0 +1,193 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <chrono>
+
+#include "core/gpu/shader.h"
+
+// Frames kept for the percentiles and the trace
+#define PROFILER_HISTORY 240
+
+// Frames between issuing the GPU queries of a frame and reading them back
+#define PROFILER_GPU_LATENCY 4
+
+// Scopes kept per frame for the trace, the others only count in the totals
+#define PROFILER_MAX_EVENTS 32
+
+// Deepest nesting of scopes
+#define PROFILER_MAX_DEPTH 8
+
+namespace m1 {
+
+	enum ProfilePhase {
+		PHASE_FRAME_START,
+		PHASE_INPUT,
+		PHASE_RENDER_MAIN,
+		PHASE_RENDER_MINIMAP,
+		PHASE_TEXT,
+		NR_PHASES
+	};
+
+	const char *phaseName(ProfilePhase phase);
+
+	/**
+	 * CPU and GPU time of every phase of the last PROFILER_HISTORY frames
+	 *
+	 * The GPU time comes from GL_TIME_ELAPSED queries, read back
+	 * PROFILER_GPU_LATENCY frames later and only once available, so
+	 * profiling never stalls the pipeline. Those queries cannot nest: a
+	 * nested scope pauses the query of its parent, the GPU time of a phase
+	 * leaves out the phases inside it while its CPU time includes them
+	 *
+	 * Disabled, a scope costs one branch and no query is issued
+	 */
+	class FrameProfiler {
+	public:
+		FrameProfiler();
+		~FrameProfiler();
+
+		FrameProfiler(const FrameProfiler &) = delete;
+		FrameProfiler &operator=(const FrameProfiler &) = delete;
+
+		/**
+		 * The queries are created on the first frame enabled, with the GL context current
+		 */
+		void setEnabled(bool enable);
+
+		inline bool isEnabled() const
+		{
+			return enabled;
+		}
+
+		void begin(ProfilePhase phase);
+		void end();
+
+		/**
+		 * Closes the current frame, to be called once after the last scope
+		 */
+		void endFrame();
+
+		struct Percentiles {
+			float p50 = 0;
+			float p95 = 0;
+			float p99 = 0;
+		};
+
+		/**
+		 * Milliseconds over the frames in the history, GPU times only
+		 * over the frames already read back
+		 */
+		Percentiles getCpuPercentiles(ProfilePhase phase) const;
+		Percentiles getGpuPercentiles(ProfilePhase phase) const;
+
+		/**
+		 * Writes the history as Chrome trace JSON (chrome://tracing, Perfetto)
+		 * GPU slices are placed at the CPU start of their phase, the queries
+		 * only measure durations
+		 */
+		bool exportTrace(const std::string &path) const;
+
+	private:
+		struct Event {
+			ProfilePhase phase;
+			double startUs;
+			double durUs;
+		};
+
+		struct Frame {
+			unsigned long long index = 0;
+			double startUs = 0;
+			double durUs = 0;
+
+			float cpuMs[NR_PHASES] = {};
+			float gpuMs[NR_PHASES] = {};
+			bool gpuValid = false;
+
+			Event events[PROFILER_MAX_EVENTS];
+			int nrEvents = 0;
+		};
+
+		/**
+		 * Queries issued during one frame, in order
+		 */
+		struct GpuFrame {
+			std::vector<GLuint> queries;
+			std::vector<ProfilePhase> phases;
+			size_t used = 0;
+
+			unsigned long long frame = 0;
+			bool pending = false;
+		};
+
+		std::chrono::steady_clock::time_point epoch;
+		bool enabled = false;
+
+		// Ring buffer, the frame being recorded included
+		std::vector<Frame> history;
+		unsigned long long frameIndex = 0;
+
+		ProfilePhase stack[PROFILER_MAX_DEPTH];
+		double stackStart[PROFILER_MAX_DEPTH];
+		int depth = 0;
+		// Scopes opened past PROFILER_MAX_DEPTH, ignored
+		int overflow = 0;
+
+		// First frame recorded since the profiler was enabled
+		unsigned long long firstFrame = 0;
+
+		GpuFrame gpuFrames[PROFILER_GPU_LATENCY];
+		int gpuSlot = 0;
+
+		double now() const;
+
+		inline Frame &current()
+		{
+			return history[frameIndex % PROFILER_HISTORY];
+		}
+
+		void beginQuery(ProfilePhase phase);
+		void endQuery();
+		void collect(GpuFrame &gpu);
+
+		Percentiles percentiles(ProfilePhase phase, bool gpu) const;
+	};
+
+	/**
+	 * Profiles the enclosing block as @a phase
+	 */
+	class ProfileScope {
+	public:
+		inline ProfileScope(FrameProfiler &profiler, ProfilePhase phase)
+			: profiler(profiler.isEnabled() ? &profiler : nullptr)
+		{
+			if (this->profiler != nullptr) {
+				this->profiler->begin(phase);
+			}
+		}
+
+		inline ~ProfileScope()
+		{
+			if (profiler != nullptr) {
+				profiler->end();
+			}
+		}
+
+		ProfileScope(const ProfileScope &) = delete;
+		ProfileScope &operator=(const ProfileScope &) = delete;
+
+	private:
+		FrameProfiler *profiler;
+	};
+
+} // namespace m1
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+
+// Builds with TEMA2_NO_PROFILER leave no trace of the scopes
+#ifdef TEMA2_NO_PROFILER
+#define PROFILE_SCOPE(profiler, phase)
+#else
+#define PROFILE_SCOPE(profiler, phase) m1::ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(profiler, phase)
+#endif
@@ -0,0 +1,104 @@
+#include "minimapCache.h"
+
+using namespace m1;
+
+MinimapCache::~MinimapCache()
+{
+	release();
+}
+
+void MinimapCache::release()
+{
+	if (fbo == 0) {
+		return;
+	}
+
+	glDeleteFramebuffers(1, &fbo);
+	glDeleteTextures(1, &texture);
+	glDeleteRenderbuffers(1, &depth);
+	glDeleteVertexArrays(1, &emptyVao);
+
+	fbo = texture = depth = emptyVao = 0;
+	width = height = 0;
+}
+
+bool MinimapCache::resize(int width, int height)
+{
+	if (fbo != 0 && width == this->width && height == this->height) {
+		return false;
+	}
+
+	release();
+
+	this->width = width;
+	this->height = height;
+
+	glGenTextures(1, &texture);
+	glBindTexture(GL_TEXTURE_2D, texture);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	glGenRenderbuffers(1, &depth);
+	glBindRenderbuffer(GL_RENDERBUFFER, depth);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+	glGenFramebuffers(1, &fbo);
+	glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture, 0);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depth);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	// The quad is generated from gl_VertexID, but core profile still needs a VAO bound
+	glGenVertexArrays(1, &emptyVao);
+
+	return true;
+}
+
+void MinimapCache::begin(const glm::vec3 &clearColor)
+{
+	glGetIntegerv(GL_FRAMEBUFFER_BINDING, &prevFbo);
+	glGetIntegerv(GL_VIEWPORT, prevViewport);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+	glViewport(0, 0, width, height);
+
+	glClearColor(clearColor.x, clearColor.y, clearColor.z, 1);
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+}
+
+void MinimapCache::end()
+{
+	glBindFramebuffer(GL_FRAMEBUFFER, prevFbo);
+	glViewport(prevViewport[0], prevViewport[1], prevViewport[2], prevViewport[3]);
+}
+
+void MinimapCache::draw(Shader *shader, obj3D::RenderCounters *counters) const
+{
+	if (fbo == 0 || shader == nullptr || !shader->program) {
+		return;
+	}
+
+	shader->Use();
+
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, texture);
+
+	glDisable(GL_DEPTH_TEST);
+	glBindVertexArray(emptyVao);
+	glDrawArrays(GL_TRIANGLES, 0, 3);
+	glBindVertexArray(0);
+	glEnable(GL_DEPTH_TEST);
+
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	if (counters != nullptr) {
+		counters->programBinds++;
+		counters->bufferBinds++;
+		counters->draw(1);
+	}
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "core/gpu/shader.h"
+#include "utils/glm_utils.h"
+
+#include "3D/renderCounters.h"
+
+namespace m1 {
+
+	/**
+	 * Offscreen color + depth target holding the static layer of the minimap
+	 */
+	class MinimapCache {
+	public:
+		MinimapCache() {}
+		~MinimapCache();
+
+		MinimapCache(const MinimapCache &) = delete;
+		MinimapCache &operator=(const MinimapCache &) = delete;
+
+		/**
+		 * (Re)creates the target if its size changed, returns true if it did
+		 */
+		bool resize(int width, int height);
+
+		/**
+		 * Redirects rendering to the target and clears it
+		 */
+		void begin(const glm::vec3 &clearColor);
+		void end();
+
+		/**
+		 * Draws the cached image over the current viewport
+		 */
+		void draw(Shader *shader, obj3D::RenderCounters *counters = nullptr) const;
+
+	private:
+		GLuint fbo = 0;
+		GLuint texture = 0;
+		GLuint depth = 0;
+		GLuint emptyVao = 0;
+
+		int width = 0;
+		int height = 0;
+
+		GLint prevFbo = 0;
+		GLint prevViewport[4] = {};
+
+		void release();
+	};
+
+} // namespace m1
@@ -0,0 +1,47 @@
+#include "renderQueue.h"
+
+#include <algorithm>
+#include <cstring>
+
+using namespace m1;
+
+uint64_t RenderQueue::makeKey(ShaderId shader, MeshId mesh, float depth)
+{
+	// The bits of a non-negative float sort the same way as its value
+	uint32_t depthBits;
+	depth = std::max(0.f, depth);
+	std::memcpy(&depthBits, &depth, sizeof(depthBits));
+
+	return (static_cast<uint64_t>(shader) << 56)
+		| (static_cast<uint64_t>(mesh) << 48)
+		| depthBits;
+}
+
+void RenderQueue::begin(const glm::vec3 &eye)
+{
+	this->eye = eye;
+	items.clear();
+}
+
+void RenderQueue::push(ShaderId shader, MeshId mesh, const glm::mat4 &model)
+{
+	float depth = glm::distance(eye, glm::vec3(model[3]));
+	items.push_back({ makeKey(shader, mesh, depth), DrawItem::MESH, shader, mesh, model });
+}
+
+void RenderQueue::pushInstanced(ShaderId shader, MeshId mesh)
+{
+	items.push_back({ makeKey(shader, mesh, 0), DrawItem::INSTANCED, shader, mesh, glm::mat4(1) });
+}
+
+void RenderQueue::pushTerrain(ShaderId shader)
+{
+	items.push_back({ makeKey(shader, MESH_TERRAIN, 0), DrawItem::TERRAIN, shader, MESH_TERRAIN, glm::mat4(1) });
+}
+
+void RenderQueue::sort()
+{
+	std::sort(items.begin(), items.end(), [](const DrawItem &a, const DrawItem &b) {
+		return a.key < b.key;
+	});
+}
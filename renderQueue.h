@@ -0,0 +1,83 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+#include "utils/glm_utils.h"
+
+namespace m1 {
+
+	enum MeshId {
+		MESH_TERRAIN_TILE,
+		MESH_TERRAIN,
+		MESH_TREE,
+		MESH_BUILDING,
+		MESH_BASE,
+		MESH_BLADE,
+		MESH_TARGET,
+		MESH_DELIVERY,
+		MESH_INDICATOR,
+		NR_MESHES
+	};
+
+	enum ShaderId {
+		SHADER_VERTEX_COLOR,
+		SHADER_FOW,
+		SHADER_TERRAIN,
+		SHADER_OBSTACLE,
+		SHADER_MINIMAP,
+		NR_SHADERS
+	};
+
+	struct DrawItem {
+		enum Kind { MESH, INSTANCED, TERRAIN };
+
+		// Shader, then mesh, then depth
+		uint64_t key;
+
+		Kind kind;
+		ShaderId shader;
+		MeshId mesh;
+
+		glm::mat4 model;
+	};
+
+	/**
+	 * Draws of one pass, sorted so that consecutive items share as much state as possible
+	 * Only handles are stored, the owner resolves them when submitting
+	 */
+	class RenderQueue {
+	public:
+		RenderQueue() {}
+
+		/**
+		 * Starts a new pass, depths are measured from @a eye
+		 */
+		void begin(const glm::vec3 &eye);
+
+		void push(ShaderId shader, MeshId mesh, const glm::mat4 &model);
+		void pushInstanced(ShaderId shader, MeshId mesh);
+		void pushTerrain(ShaderId shader);
+
+		/**
+		 * By shader, then mesh, then front to back
+		 */
+		void sort();
+
+		inline const std::vector<DrawItem> &getItems() const
+		{
+			return items;
+		}
+		inline const glm::vec3 &getEye() const
+		{
+			return eye;
+		}
+
+	private:
+		std::vector<DrawItem> items;
+		glm::vec3 eye;
+
+		static uint64_t makeKey(ShaderId shader, MeshId mesh, float depth);
+	};
+
+} // namespace m1
@@ -0,0 +1,12 @@
+#version 330
+
+// Input
+in vec3 fcolor;
+
+// Output
+layout(location = 0) out vec4 out_color;
+
+void main()
+{
+	out_color = vec4(fcolor, 1);
+}
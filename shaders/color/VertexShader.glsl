@@ -0,0 +1,26 @@
+#version 330
+
+// Input
+layout(location = 0) in vec3 pos;
+layout(location = 1) in vec3 normal;
+layout(location = 2) in vec2 tex;
+layout(location = 3) in vec3 color;
+
+// Uniform properties
+uniform mat4 Model;
+
+layout(std140) uniform Camera {
+	mat4 View;
+	mat4 Projection;
+	vec4 dronePos;
+	int fow;
+};
+
+out vec3 fcolor;
+
+void main()
+{
+	fcolor = color;
+
+	gl_Position = Projection * View * Model * vec4(pos, 1);
+}
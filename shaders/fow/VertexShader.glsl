@@ -8,11 +8,13 @@ layout(location = 3) in vec3 color;
 
 // Uniform properties
 uniform mat4 Model;
-uniform mat4 View;
-uniform mat4 Projection;
 
-// Output
-uniform vec3 dronePos;
+layout(std140) uniform Camera {
+	mat4 View;
+	mat4 Projection;
+	vec4 dronePos;
+	int fow;
+};
 
 out vec3 fcolor;
 out float dist;
@@ -20,7 +22,7 @@ out float dist;
 void main()
 {
 	vec3 worldPos = (Model * vec4(pos, 1.0f)).xyz;
-	dist = distance(worldPos, dronePos);
+	dist = distance(worldPos, dronePos.xyz);
 
 	fcolor = color;
 
@@ -0,0 +1,15 @@
+#version 330
+
+// Input
+in vec2 texCoord;
+
+// Output
+layout(location = 0) out vec4 out_color;
+
+// Uniform properties
+uniform sampler2D minimap;
+
+void main()
+{
+	out_color = texture(minimap, texCoord);
+}
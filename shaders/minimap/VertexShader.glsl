@@ -0,0 +1,13 @@
+#version 330
+
+// Output
+out vec2 texCoord;
+
+void main()
+{
+	// Triangle covering the whole viewport, built from the vertex index
+	vec2 pos = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+	texCoord = pos;
+
+	gl_Position = vec4(pos * 2.0f - 1.0f, 0, 1);
+}
@@ -0,0 +1,26 @@
+#version 330
+
+// Input
+in vec3 fcolor;
+in float dist;
+
+// Output
+layout(location = 0) out vec4 out_color;
+
+// Uniform properties
+layout(std140) uniform Camera {
+	mat4 View;
+	mat4 Projection;
+	vec4 dronePos;
+	int fow;
+};
+
+void main()
+{
+	vec3 tmp = fcolor;
+	if (fow > 0) {
+		tmp = mix(tmp, tmp / 100.f, min(15, dist) / 15.0f);
+	}
+
+	out_color = vec4(tmp, 1);
+}
@@ -0,0 +1,29 @@
+#version 330
+
+// Input
+layout(location = 0) in vec3 pos;
+layout(location = 1) in vec3 normal;
+layout(location = 2) in vec2 tex;
+layout(location = 3) in vec3 color;
+layout(location = 4) in mat4 instanceModel;
+
+// Uniform properties
+layout(std140) uniform Camera {
+	mat4 View;
+	mat4 Projection;
+	vec4 dronePos;
+	int fow;
+};
+
+out vec3 fcolor;
+out float dist;
+
+void main()
+{
+	vec4 worldPos = instanceModel * vec4(pos, 1.0f);
+	dist = distance(worldPos.xyz, dronePos.xyz);
+
+	fcolor = color;
+
+	gl_Position = Projection * View * worldPos;
+}
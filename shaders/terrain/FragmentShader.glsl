@@ -7,8 +7,13 @@ in float dist;
 // Output
 layout(location = 0) out vec4 out_color;
 
-// Variables
-uniform int fow;
+// Uniform properties
+layout(std140) uniform Camera {
+	mat4 View;
+	mat4 Projection;
+	vec4 dronePos;
+	int fow;
+};
 
 vec3 color_green = vec3(0.0, 0.392, 0.0);
 vec3 color_brown = vec3(0.545, 0.271, 0.0);
@@ -0,0 +1,433 @@
+#include "inputTrace.h"
+
+#include <cstring>
+#include <climits>
+#include <algorithm>
+
+using namespace sim;
+
+// Bits of the held controls in a frame record
+enum TraceControl {
+	CONTROL_FORWARD,
+	CONTROL_BACKWARD,
+	CONTROL_RIGHT,
+	CONTROL_LEFT,
+	CONTROL_UP,
+	CONTROL_DOWN,
+	CONTROL_ROTATE_LEFT,
+	CONTROL_ROTATE_RIGHT,
+	CONTROL_BOOST,
+	// The directions follow the bits
+	CONTROL_NEW_DIRS
+};
+
+TraceEnd sim::traceEnd(const Simulation &simulation)
+{
+	TraceEnd end;
+	end.pos = simulation.getDrone().pos;
+	end.angle = simulation.getDrone().angle;
+	end.score = simulation.getScore();
+	end.ticks = simulation.getTickCount();
+
+	return end;
+}
+
+void sim::startTraceWorld(Simulation &simulation, const TraceEvent &event)
+{
+	simulation.setConfig(event.config);
+
+	if (event.streaming) {
+		simulation.restartStreaming(event.seed);
+	} else {
+		simulation.restart(event.seed);
+	}
+}
+
+TraceWriter::~TraceWriter()
+{
+	if (out != nullptr) {
+		std::fclose(out);
+	}
+}
+
+bool TraceWriter::open(const std::string &path)
+{
+	if (out != nullptr) {
+		std::fclose(out);
+	}
+
+	out = std::fopen(path.c_str(), "wb");
+	if (out == nullptr) {
+		return false;
+	}
+
+	failed = false;
+	lastForward = lastRight = glm::vec3(0);
+
+	put32(TRACE_MAGIC);
+	put16(TRACE_VERSION);
+
+	return !failed;
+}
+
+void TraceWriter::put(const void *data, size_t size)
+{
+	if (std::fwrite(data, 1, size, out) != size) {
+		failed = true;
+	}
+}
+
+void TraceWriter::put8(uint8_t v)
+{
+	put(&v, 1);
+}
+
+void TraceWriter::put16(uint16_t v)
+{
+	uint8_t bytes[2] = { static_cast<uint8_t>(v), static_cast<uint8_t>(v >> 8) };
+	put(bytes, sizeof(bytes));
+}
+
+void TraceWriter::put32(uint32_t v)
+{
+	put16(static_cast<uint16_t>(v));
+	put16(static_cast<uint16_t>(v >> 16));
+}
+
+void TraceWriter::put64(uint64_t v)
+{
+	put32(static_cast<uint32_t>(v));
+	put32(static_cast<uint32_t>(v >> 32));
+}
+
+void TraceWriter::putFloat(float v)
+{
+	uint32_t bits;
+	std::memcpy(&bits, &v, sizeof(bits));
+	put32(bits);
+}
+
+void TraceWriter::world(const Simulation &simulation)
+{
+	if (out == nullptr) {
+		return;
+	}
+
+	// What the current world was built with, not the configured one
+	const WorldConfig &config = simulation.getWorldConfig();
+	unsigned int seed = simulation.isStreaming() ? simulation.getStreamer().getSeed()
+		: simulation.getTerrain().getSeed();
+
+	put8(TRACE_WORLD);
+	put32(seed);
+	put8(simulation.isStreaming() ? 1 : 0);
+	put32(config.sizeX);
+	put32(config.sizeZ);
+	put32(config.maxY);
+	put32(config.tilesPerObstacle);
+}
+
+void TraceWriter::frame(const InputState &input, float deltaTime)
+{
+	if (out == nullptr) {
+		return;
+	}
+
+	bool controls[CONTROL_NEW_DIRS] = {
+		input.forward, input.backward, input.right, input.left, input.up, input.down,
+		input.rotateLeft, input.rotateRight, input.boost
+	};
+
+	uint16_t bits = 0;
+	for (int i = 0; i < CONTROL_NEW_DIRS; i++) {
+		bits |= controls[i] ? (1 << i) : 0;
+	}
+
+	bool newDirs = (input.forwardDir != lastForward || input.rightDir != lastRight);
+	bits |= newDirs ? (1 << CONTROL_NEW_DIRS) : 0;
+
+	put8(TRACE_FRAME);
+	putFloat(deltaTime);
+	put16(bits);
+
+	if (newDirs) {
+		for (int i = 0; i < 3; i++) {
+			putFloat(input.forwardDir[i]);
+		}
+		for (int i = 0; i < 3; i++) {
+			putFloat(input.rightDir[i]);
+		}
+
+		lastForward = input.forwardDir;
+		lastRight = input.rightDir;
+	}
+}
+
+void TraceWriter::key(int key, int mods)
+{
+	if (out == nullptr) {
+		return;
+	}
+
+	put8(TRACE_KEY);
+	put16(static_cast<uint16_t>(key));
+	put8(static_cast<uint8_t>(mods));
+}
+
+void TraceWriter::mouse(int deltaX, int deltaY)
+{
+	if (out == nullptr) {
+		return;
+	}
+
+	put8(TRACE_MOUSE);
+	put16(static_cast<uint16_t>(std::max(SHRT_MIN, std::min(SHRT_MAX, deltaX))));
+	put16(static_cast<uint16_t>(std::max(SHRT_MIN, std::min(SHRT_MAX, deltaY))));
+}
+
+bool TraceWriter::close(const Simulation &simulation)
+{
+	if (out == nullptr) {
+		return false;
+	}
+
+	TraceEnd end = traceEnd(simulation);
+
+	put8(TRACE_END);
+	for (int i = 0; i < 3; i++) {
+		putFloat(end.pos[i]);
+	}
+	putFloat(end.angle);
+	put32(static_cast<uint32_t>(end.score));
+	put64(end.ticks);
+
+	bool ok = !failed && std::fclose(out) == 0;
+	out = nullptr;
+
+	return ok;
+}
+
+TraceReader::~TraceReader()
+{
+	close();
+}
+
+bool TraceReader::open(const std::string &path)
+{
+	close();
+
+	in = std::fopen(path.c_str(), "rb");
+	if (in == nullptr) {
+		return false;
+	}
+
+	lastForward = lastRight = glm::vec3(0);
+
+	uint32_t magic = 0;
+	uint16_t version = 0;
+	if (!get32(magic) || !get16(version) || magic != TRACE_MAGIC || version != TRACE_VERSION) {
+		close();
+		return false;
+	}
+
+	return true;
+}
+
+void TraceReader::close()
+{
+	if (in != nullptr) {
+		std::fclose(in);
+		in = nullptr;
+	}
+}
+
+bool TraceReader::get(void *data, size_t size)
+{
+	return std::fread(data, 1, size, in) == size;
+}
+
+bool TraceReader::get8(uint8_t &v)
+{
+	return get(&v, 1);
+}
+
+bool TraceReader::get16(uint16_t &v)
+{
+	uint8_t bytes[2];
+	if (!get(bytes, sizeof(bytes))) {
+		return false;
+	}
+
+	v = static_cast<uint16_t>(bytes[0] | (bytes[1] << 8));
+	return true;
+}
+
+bool TraceReader::get32(uint32_t &v)
+{
+	uint16_t lo, hi;
+	if (!get16(lo) || !get16(hi)) {
+		return false;
+	}
+
+	v = lo | (static_cast<uint32_t>(hi) << 16);
+	return true;
+}
+
+bool TraceReader::get64(uint64_t &v)
+{
+	uint32_t lo, hi;
+	if (!get32(lo) || !get32(hi)) {
+		return false;
+	}
+
+	v = lo | (static_cast<uint64_t>(hi) << 32);
+	return true;
+}
+
+bool TraceReader::getFloat(float &v)
+{
+	uint32_t bits;
+	if (!get32(bits)) {
+		return false;
+	}
+
+	std::memcpy(&v, &bits, sizeof(v));
+	return true;
+}
+
+bool TraceReader::next(TraceEvent &event)
+{
+	uint8_t tag;
+	if (in == nullptr || !get8(tag)) {
+		return false;
+	}
+
+	event = TraceEvent();
+	event.kind = static_cast<TraceEventKind>(tag);
+
+	switch (tag) {
+	case TRACE_FRAME: {
+		uint16_t bits;
+		if (!getFloat(event.deltaTime) || !get16(bits)) {
+			return false;
+		}
+
+		bool *controls[CONTROL_NEW_DIRS] = {
+			&event.input.forward, &event.input.backward, &event.input.right, &event.input.left,
+			&event.input.up, &event.input.down, &event.input.rotateLeft, &event.input.rotateRight,
+			&event.input.boost
+		};
+
+		for (int i = 0; i < CONTROL_NEW_DIRS; i++) {
+			*controls[i] = (bits & (1 << i)) != 0;
+		}
+
+		if (bits & (1 << CONTROL_NEW_DIRS)) {
+			for (int i = 0; i < 3; i++) {
+				if (!getFloat(lastForward[i])) {
+					return false;
+				}
+			}
+			for (int i = 0; i < 3; i++) {
+				if (!getFloat(lastRight[i])) {
+					return false;
+				}
+			}
+		}
+
+		event.input.forwardDir = lastForward;
+		event.input.rightDir = lastRight;
+		return true;
+	}
+	case TRACE_KEY: {
+		uint16_t key;
+		uint8_t mods;
+		if (!get16(key) || !get8(mods)) {
+			return false;
+		}
+
+		event.key = static_cast<int16_t>(key);
+		event.mods = mods;
+		return true;
+	}
+	case TRACE_MOUSE: {
+		uint16_t dx, dy;
+		if (!get16(dx) || !get16(dy)) {
+			return false;
+		}
+
+		event.deltaX = static_cast<int16_t>(dx);
+		event.deltaY = static_cast<int16_t>(dy);
+		return true;
+	}
+	case TRACE_WORLD: {
+		uint8_t streaming;
+		uint32_t values[4];
+		if (!get32(event.seed) || !get8(streaming)) {
+			return false;
+		}
+		for (auto &&v : values) {
+			if (!get32(v)) {
+				return false;
+			}
+		}
+
+		// Same limits as a config file, a corrupt size would reach the generator
+		static const char *keys[4] = { "size_x", "size_z", "max_y", "tiles_per_obstacle" };
+		for (int i = 0; i < 4; i++) {
+			if (!event.config.set(keys[i], std::to_string(values[i]))) {
+				return false;
+			}
+		}
+
+		event.streaming = (streaming != 0);
+		return true;
+	}
+	case TRACE_END: {
+		uint32_t score;
+		uint64_t ticks;
+		for (int i = 0; i < 3; i++) {
+			if (!getFloat(event.end.pos[i])) {
+				return false;
+			}
+		}
+		if (!getFloat(event.end.angle) || !get32(score) || !get64(ticks)) {
+			return false;
+		}
+
+		event.end.score = static_cast<int>(score);
+		event.end.ticks = ticks;
+		return true;
+	}
+	default:
+		return false;
+	}
+}
+
+FrameTimes::Summary FrameTimes::summarize() const
+{
+	Summary res;
+	if (values.empty()) {
+		return res;
+	}
+
+	std::vector<float> sorted = values;
+	std::sort(sorted.begin(), sorted.end());
+
+	auto at = [&sorted](float q) {
+		return sorted[static_cast<size_t>(q * (sorted.size() - 1) + 0.5f)];
+	};
+
+	double sum = 0;
+	for (float v : sorted) {
+		sum += v;
+	}
+
+	res.mean = static_cast<float>(sum / sorted.size());
+	res.p50 = at(0.50f);
+	res.p95 = at(0.95f);
+	res.p99 = at(0.99f);
+	res.max = sorted.back();
+
+	return res;
+}
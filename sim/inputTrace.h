@@ -0,0 +1,188 @@
+#pragma once
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "simulation.h"
+
+// "T2TR", then the version
+#define TRACE_MAGIC 0x52543254u
+#define TRACE_VERSION 1
+
+namespace sim {
+
+	enum TraceEventKind { TRACE_FRAME, TRACE_KEY, TRACE_MOUSE, TRACE_WORLD, TRACE_END };
+
+	/**
+	 * Where a recording left the simulation, a replay has to end in the same state
+	 */
+	struct TraceEnd {
+		glm::vec3 pos = glm::vec3(0);
+		float angle = 0;
+		int score = 0;
+		unsigned long long ticks = 0;
+
+		inline bool operator==(const TraceEnd &other) const
+		{
+			return pos == other.pos && angle == other.angle
+				&& score == other.score && ticks == other.ticks;
+		}
+	};
+
+	TraceEnd traceEnd(const Simulation &simulation);
+
+	/**
+	 * One record of a trace, only the fields of its kind are meaningful
+	 */
+	struct TraceEvent {
+		TraceEventKind kind = TRACE_FRAME;
+
+		// TRACE_FRAME: what the simulation was advanced with
+		InputState input;
+		float deltaTime = 0;
+
+		// TRACE_KEY
+		int key = 0;
+		int mods = 0;
+
+		// TRACE_MOUSE
+		int deltaX = 0;
+		int deltaY = 0;
+
+		// TRACE_WORLD: a new world was started
+		unsigned int seed = 0;
+		bool streaming = false;
+		WorldConfig config;
+
+		// TRACE_END
+		TraceEnd end;
+	};
+
+	/**
+	 * Restarts @a simulation in the world of a TRACE_WORLD event, blocking
+	 */
+	void startTraceWorld(Simulation &simulation, const TraceEvent &event);
+
+	/**
+	 * Records everything a replay needs to fly the same path, as a
+	 * compact little endian stream of tagged records
+	 *
+	 * A frame takes 7 bytes, 31 when the camera turned since the last one:
+	 * the delta time, the held controls as bits and, if they changed, the
+	 * directions the drone moves along. Keys and mouse moves are kept for
+	 * the camera and the toggles of the game, the simulation never reads them
+	 */
+	class TraceWriter {
+	public:
+		TraceWriter() {}
+		~TraceWriter();
+
+		TraceWriter(const TraceWriter &) = delete;
+		TraceWriter &operator=(const TraceWriter &) = delete;
+
+		bool open(const std::string &path);
+
+		inline bool isOpen() const
+		{
+			return out != nullptr;
+		}
+
+		/**
+		 * To be written right after @a simulation started a world, a
+		 * trace has to start with one to be replayed
+		 */
+		void world(const Simulation &simulation);
+		void frame(const InputState &input, float deltaTime);
+		void key(int key, int mods);
+		void mouse(int deltaX, int deltaY);
+
+		/**
+		 * Ends the trace with the state of @a simulation and closes it
+		 * Returns false if anything could not be written
+		 */
+		bool close(const Simulation &simulation);
+
+	private:
+		FILE *out = nullptr;
+		bool failed = false;
+
+		glm::vec3 lastForward = glm::vec3(0);
+		glm::vec3 lastRight = glm::vec3(0);
+
+		void put(const void *data, size_t size);
+		void put8(uint8_t v);
+		void put16(uint16_t v);
+		void put32(uint32_t v);
+		void put64(uint64_t v);
+		void putFloat(float v);
+	};
+
+	class TraceReader {
+	public:
+		TraceReader() {}
+		~TraceReader();
+
+		TraceReader(const TraceReader &) = delete;
+		TraceReader &operator=(const TraceReader &) = delete;
+
+		/**
+		 * Returns false if the file cannot be read or is not a trace
+		 */
+		bool open(const std::string &path);
+		void close();
+
+		inline bool isOpen() const
+		{
+			return in != nullptr;
+		}
+
+		/**
+		 * Returns false at the end of the trace, or on a bad record
+		 */
+		bool next(TraceEvent &event);
+
+	private:
+		FILE *in = nullptr;
+
+		glm::vec3 lastForward = glm::vec3(0);
+		glm::vec3 lastRight = glm::vec3(0);
+
+		bool get(void *data, size_t size);
+		bool get8(uint8_t &v);
+		bool get16(uint16_t &v);
+		bool get32(uint32_t &v);
+		bool get64(uint64_t &v);
+		bool getFloat(float &v);
+	};
+
+	/**
+	 * Milliseconds of the frames of a run, summarized as percentiles
+	 */
+	class FrameTimes {
+	public:
+		inline void add(float ms)
+		{
+			values.push_back(ms);
+		}
+
+		inline size_t size() const
+		{
+			return values.size();
+		}
+
+		struct Summary {
+			float mean = 0;
+			float p50 = 0;
+			float p95 = 0;
+			float p99 = 0;
+			float max = 0;
+		};
+
+		Summary summarize() const;
+
+	private:
+		std::vector<float> values;
+	};
+
+} // namespace sim
@@ -0,0 +1,99 @@
+/*
+ * Checks that every SIMD level of the obstacle hit kernels supported by
+ * this CPU gives the same answers as obstacleHit(), on random drones and
+ * obstacles. Run by ctest.
+ *
+ *   tema2_kernel_test [tests] [seed]
+ *
+ * The exit code is 1 on any disagreement
+ */
+
+#ifdef TEMA2_SIM_TOOLS
+
+#include "../3D/assets/terrain/obstacleKernels.h"
+#include "../3D/assets/drone/drone.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+
+using namespace obj3D;
+
+/**
+ * hitBatch() as dispatched at the current level, partial batches included
+ */
+static size_t checkDispatch(unsigned int seed, size_t nrTests)
+{
+	std::mt19937 gen(seed);
+
+	std::uniform_real_distribution<float> distPos(-3.f, 3.f);
+	std::uniform_real_distribution<float> distY(-1.f, 12.f);
+	std::uniform_real_distribution<float> distScale(4.f, 10.f);
+	std::uniform_int_distribution<int> distCount(1, HIT_BATCH);
+
+	size_t mismatches = 0;
+	float x[HIT_BATCH], z[HIT_BATCH], size[HIT_BATCH], h[HIT_BATCH];
+
+	for (size_t test = 0; test < nrTests; test += HIT_BATCH) {
+		DroneProbe probe;
+		probe.pos = glm::vec3(distPos(gen), distY(gen), distPos(gen));
+		probe.rxz = DRONE_SIZE * DRONE_L / 2.f;
+		probe.ry = DRONE_SIZE * DRONE_h * 0.75f;
+		probe.hasTarget = (test / HIT_BATCH) % 2 == 0;
+		probe.ryTarget = probe.hasTarget ? probe.ry + 0.3f / 1.5f : probe.ry;
+
+		ObstacleKind kind = (test / HIT_BATCH) % 3 == 0 ? OBSTACLE_BUILDING : OBSTACLE_TREE;
+		size_t count = distCount(gen);
+
+		for (int i = 0; i < HIT_BATCH; i++) {
+			float scaleY = distScale(gen);
+			float scaleXZ = scaleY * 3.f / 5.f;
+
+			x[i] = distPos(gen);
+			z[i] = distPos(gen);
+			size[i] = (kind == OBSTACLE_TREE) ? scaleXZ * 0.5f : scaleXZ;
+			h[i] = scaleY;
+		}
+
+		uint32_t got = hitBatch(kind, x, z, size, h, count, probe);
+
+		for (size_t i = 0; i < HIT_BATCH; i++) {
+			bool expected = (i < count) && obstacleHit({ kind, x[i], z[i], size[i], h[i] }, probe);
+			if (((got >> i) & 1) != (expected ? 1u : 0u)) {
+				mismatches++;
+			}
+		}
+	}
+
+	return mismatches;
+}
+
+int main(int argc, char **argv)
+{
+	size_t nrTests = (argc > 1) ? std::strtoul(argv[1], nullptr, 10) : 200000;
+	unsigned int seed = (argc > 2) ? std::strtoul(argv[2], nullptr, 10) : 42;
+
+	SimdLevel best = detectSimdLevel();
+	size_t total = 0;
+
+	// Every supported level against the scalar one, on several seeds
+	for (unsigned int s = seed; s < seed + 4; s++) {
+		size_t mismatches = checkHitKernels(s, nrTests);
+		std::printf("kernels  seed %u: %zu mismatches\n", s, mismatches);
+		total += mismatches;
+	}
+
+	for (int level = SIMD_SCALAR; level <= best; level++) {
+		SimdLevel used = setSimdLevel(static_cast<SimdLevel>(level));
+
+		size_t mismatches = checkDispatch(seed, nrTests);
+		std::printf("hitBatch %-6s: %zu mismatches\n", simdLevelName(used), mismatches);
+		total += mismatches;
+	}
+
+	setSimdLevel(best);
+
+	return (total == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+#endif
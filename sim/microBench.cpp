@@ -0,0 +1,491 @@
+/*
+ * Microbenchmarks of the hot functions of the game, with no GL:
+ *
+ *   terrain_hit_*         Terrain::hit() near the ground, among the
+ *                         obstacles and above them
+ *   terrain_sweep         Terrain::sweep() over a fast tick
+ *   terrain_get_y         Terrain::getTerrainY()
+ *   terrain_check_pos     Terrain::checkPosition() of a random obstacle
+ *   terrain_generate_N    Terrain::generate() of an N x N world
+ *   mesh_merge_large      MeshData::merge() of three 64k vertex parts
+ *   mesh_append_many      MeshData::append() of 1000 tree sized parts
+ *   drone_blade_matrices  Drone::getBladeMatrices()
+ *   camera_*              GameCamera rotations
+ *
+ *   tema2_micro_bench [--filter <substring>] [--repetitions R] [--min-ms M]
+ *                     [--seed S] [--sizes 100,250,500] [--threads N]
+ *                     [--simd scalar|sse|avx2] [--out <file>]
+ *                     [--baseline <file>] [--threshold <percent>]
+ *
+ * Every benchmark is calibrated so that one run lasts at least M ms, then
+ * run R times and reported as the median ns per operation, with the
+ * fastest and the slowest run. Results are JSON, one benchmark per line,
+ * on stdout or in the --out file. Given a baseline written by an earlier
+ * run, the changes are printed on stderr and the exit code is 1 if any
+ * benchmark got slower by more than the threshold (10% by default)
+ *
+ * The batched hit kernels are checked against the scalar reference first,
+ * nothing is measured if they disagree
+ */
+
+#ifdef TEMA2_SIM_TOOLS
+
+#include "simulation.h"
+#include "../gameCamera.h"
+#include "../3D/meshData.h"
+#include "../3D/assets/terrain/obstacleKernels.h"
+
+#include <map>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <random>
+#include <sstream>
+#include <algorithm>
+#include <functional>
+
+using namespace obj3D;
+
+typedef std::chrono::steady_clock Clock;
+
+static double elapsedMs(Clock::time_point start)
+{
+	return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+static bool parseList(const std::string &value, std::vector<int> &res)
+{
+	res.clear();
+
+	std::stringstream in(value);
+	std::string item;
+
+	while (std::getline(in, item, ',')) {
+		int v = std::atoi(item.c_str());
+		if (v <= 0) {
+			return false;
+		}
+		res.push_back(v);
+	}
+
+	return !res.empty();
+}
+
+/**
+ * Folds a float into the value returned by a benchmark, so that its work is kept
+ */
+static inline size_t bits(float f)
+{
+	uint32_t u;
+	std::memcpy(&u, &f, sizeof(u));
+	return u;
+}
+
+struct Bench {
+	std::string name;
+
+	// Runs the operation @a n times, returns a value depending on all of them
+	std::function<size_t(size_t n)> run;
+};
+
+struct Result {
+	std::string name;
+	size_t iterations = 0;
+	double nsPerOp = 0;
+	double minNs = 0;
+	double maxNs = 0;
+};
+
+// Kept global so that the results of the runs are never dead code
+static volatile size_t sink;
+
+static Result measure(const Bench &bench, int repetitions, double minMs)
+{
+	// Grows the count until one run lasts minMs, the first runs warm up the caches
+	size_t n = 1;
+	for (;;) {
+		auto start = Clock::now();
+		sink = sink + bench.run(n);
+		double ms = elapsedMs(start);
+
+		if (ms >= minMs) {
+			break;
+		}
+
+		double factor = (ms > 0) ? std::min(100.0, 1.2 * minMs / ms) : 100.0;
+		n = std::max(n + 1, static_cast<size_t>(n * factor));
+	}
+
+	std::vector<double> samples;
+	for (int i = 0; i < repetitions; i++) {
+		auto start = Clock::now();
+		sink = sink + bench.run(n);
+		samples.push_back(elapsedMs(start) * 1e6 / n);
+	}
+
+	std::sort(samples.begin(), samples.end());
+
+	Result res;
+	res.name = bench.name;
+	res.iterations = n;
+	res.nsPerOp = samples[samples.size() / 2];
+	res.minNs = samples.front();
+	res.maxNs = samples.back();
+
+	return res;
+}
+
+/**
+ * Reads the ns per operation of every benchmark in a file written by writeResults()
+ */
+static bool readBaseline(const std::string &path, std::map<std::string, double> &res)
+{
+	FILE *in = std::fopen(path.c_str(), "r");
+	if (in == nullptr) {
+		return false;
+	}
+
+	char line[512];
+	while (std::fgets(line, sizeof(line), in) != nullptr) {
+		const char *name = std::strstr(line, "\"name\": \"");
+		const char *ns = std::strstr(line, "\"ns_per_op\": ");
+		if (name == nullptr || ns == nullptr) {
+			continue;
+		}
+
+		name += std::strlen("\"name\": \"");
+		const char *end = std::strchr(name, '"');
+		if (end == nullptr) {
+			continue;
+		}
+
+		res[std::string(name, end)] = std::atof(ns + std::strlen("\"ns_per_op\": "));
+	}
+
+	std::fclose(in);
+	return true;
+}
+
+static void writeResults(FILE *out, unsigned int seed, size_t mismatches, const std::vector<Result> &results)
+{
+	std::fprintf(out, "{\n\"suite\": \"tema2_micro_bench\",\n\"seed\": %u,\n", seed);
+	std::fprintf(out, "\"simd\": \"%s\",\n", simdLevelName(getSimdLevel()));
+	std::fprintf(out, "\"hit_kernel_mismatches\": %zu,\n\"benchmarks\": [\n", mismatches);
+
+	for (size_t i = 0; i < results.size(); i++) {
+		const Result &r = results[i];
+		std::fprintf(out, "{\"name\": \"%s\", \"iterations\": %zu, \"ns_per_op\": %.3f, \"min_ns\": %.3f, \"max_ns\": %.3f}%s\n",
+			r.name.c_str(), r.iterations, r.nsPerOp, r.minNs, r.maxNs, (i + 1 < results.size()) ? "," : "");
+	}
+
+	std::fprintf(out, "]\n}\n");
+}
+
+/**
+ * Returns the number of benchmarks slower than the baseline by more than @a threshold percent
+ */
+static int compare(const std::map<std::string, double> &baseline, const std::vector<Result> &results, double threshold)
+{
+	int regressions = 0;
+
+	std::fprintf(stderr, "%-26s %12s %12s %8s\n", "benchmark", "base ns", "now ns", "change");
+
+	for (auto &&r : results) {
+		auto it = baseline.find(r.name);
+		if (it == baseline.end() || it->second <= 0) {
+			std::fprintf(stderr, "%-26s %12s %12.1f %8s\n", r.name.c_str(), "-", r.nsPerOp, "new");
+			continue;
+		}
+
+		double change = (r.nsPerOp / it->second - 1.0) * 100.0;
+		bool slower = change > threshold;
+		regressions += slower ? 1 : 0;
+
+		std::fprintf(stderr, "%-26s %12.1f %12.1f %+7.1f%%%s\n", r.name.c_str(),
+			it->second, r.nsPerOp, change, slower ? "  SLOWER" : "");
+	}
+
+	return regressions;
+}
+
+int main(int argc, char **argv)
+{
+	std::string filter;
+	int repetitions = 7;
+	double minMs = 20;
+	unsigned int seed = 42;
+	std::vector<int> sizes = { 100, 250, 500 };
+	unsigned int threads = 1;
+	std::string outPath;
+	std::string baselinePath;
+	double threshold = 10;
+
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		bool ok = (i + 1 < argc);
+
+		if (ok && arg == "--filter") {
+			filter = argv[++i];
+		} else if (ok && arg == "--repetitions") {
+			repetitions = std::max(1, std::atoi(argv[++i]));
+		} else if (ok && arg == "--min-ms") {
+			minMs = std::max(0.1, std::atof(argv[++i]));
+		} else if (ok && arg == "--seed") {
+			seed = std::strtoul(argv[++i], nullptr, 10);
+		} else if (ok && arg == "--sizes") {
+			ok = parseList(argv[++i], sizes);
+		} else if (ok && arg == "--threads") {
+			threads = std::strtoul(argv[++i], nullptr, 10);
+		} else if (ok && arg == "--simd") {
+			std::string level = argv[++i];
+			SimdLevel wanted = NR_SIMD_LEVELS;
+
+			for (int l = 0; l < NR_SIMD_LEVELS; l++) {
+				if (level == simdLevelName(static_cast<SimdLevel>(l))) {
+					wanted = static_cast<SimdLevel>(l);
+				}
+			}
+
+			ok = (wanted != NR_SIMD_LEVELS) && setSimdLevel(wanted) == wanted;
+		} else if (ok && arg == "--out") {
+			outPath = argv[++i];
+		} else if (ok && arg == "--baseline") {
+			baselinePath = argv[++i];
+		} else if (ok && arg == "--threshold") {
+			threshold = std::atof(argv[++i]);
+		} else {
+			ok = false;
+		}
+
+		if (!ok) {
+			std::fprintf(stderr, "bad argument %s\n", arg.c_str());
+			return EXIT_FAILURE;
+		}
+	}
+
+	size_t mismatches = checkHitKernels(seed, 100000);
+	if (mismatches != 0) {
+		std::fprintf(stderr, "%zu hit kernel mismatches, not measuring\n", mismatches);
+		return EXIT_FAILURE;
+	}
+
+	// The world of the game with its default config
+	sim::WorldConfig config;
+	Terrain terrain;
+	terrain.generate(config.sizeX, config.sizeZ, config.getNrObstacles(), seed);
+
+	std::mt19937 gen(seed);
+	std::uniform_real_distribution<float> distX(-config.sizeX / 2.f, config.sizeX / 2.f);
+	std::uniform_real_distribution<float> distZ(-config.sizeZ / 2.f, config.sizeZ / 2.f);
+	std::uniform_real_distribution<float> distAngle(0.f, 2.f * glm::pi<float>());
+
+	// Inputs are precomputed and cycled through, a power of two long
+	const size_t nrInputs = 4096;
+
+	auto makePositions = [&](float minY, float maxY) {
+		std::uniform_real_distribution<float> distY(minY, maxY);
+		std::vector<glm::vec3> res(nrInputs);
+
+		for (auto &&pos : res) {
+			pos.x = distX(gen);
+			pos.z = distZ(gen);
+			pos.y = terrain.getTerrainY(pos.x, pos.z) + distY(gen);
+		}
+		return res;
+	};
+
+	auto ground = makePositions(0.f, 1.5f);
+	auto canopy = makePositions(1.5f, 6.f);
+	auto sky = makePositions(config.maxY * 0.8f, static_cast<float>(config.maxY));
+
+	std::vector<glm::vec3> moves(nrInputs);
+	for (auto &&move : moves) {
+		float angle = distAngle(gen);
+		move = glm::vec3(std::cos(angle), 0, std::sin(angle)) * (3.f * MAP_SIZE_Y / 5.f * SIM_TICK);
+	}
+
+	std::vector<ObstacleDesc> candidates(nrInputs);
+	for (auto &&o : candidates) {
+		o.kind = (gen() % 2) ? OBSTACLE_TREE : OBSTACLE_BUILDING;
+		o.x = distX(gen);
+		o.z = distZ(gen);
+		o.size = 1.f + (gen() % 100) / 50.f;
+		o.h = 2.f + (gen() % 100) / 20.f;
+	}
+
+	auto hitBench = [&terrain](const std::vector<glm::vec3> &positions) {
+		return [&terrain, &positions](size_t n) {
+			Drone drone;
+			drone.size = DRONE_SIZE;
+
+			size_t res = 0;
+			for (size_t i = 0; i < n; i++) {
+				drone.pos = positions[i & (nrInputs - 1)];
+				res += terrain.hit(drone) ? 1 : 0;
+			}
+			return res;
+		};
+	};
+
+	// Meshes the size of the terrain chunks and of the trees
+	auto makeGrid = [](int side) {
+		MeshData res;
+		for (int z = 0; z <= side; z++) {
+			for (int x = 0; x <= side; x++) {
+				res.vertices.emplace_back(glm::vec3(x, 0, z), glm::vec3(0.2f, 0.6f, 0.2f));
+			}
+		}
+		for (int z = 0; z < side; z++) {
+			for (int x = 0; x < side; x++) {
+				unsigned int i = z * (side + 1) + x;
+				res.indices.insert(res.indices.end(), { i, i + side + 1, i + 1, i + 1, i + side + 1, i + side + 2 });
+			}
+		}
+		return res;
+	};
+
+	MeshData large = makeGrid(255);
+	MeshData small = makeGrid(9);
+
+	Drone drone;
+	drone.size = DRONE_SIZE;
+	drone.pos = glm::vec3(0, 5, 0);
+
+	std::vector<Bench> benches;
+
+	benches.push_back({ "terrain_hit_ground", hitBench(ground) });
+	benches.push_back({ "terrain_hit_canopy", hitBench(canopy) });
+	benches.push_back({ "terrain_hit_sky", hitBench(sky) });
+
+	benches.push_back({ "terrain_sweep", [&](size_t n) {
+		Drone probe;
+		probe.size = DRONE_SIZE;
+
+		size_t res = 0;
+		for (size_t i = 0; i < n; i++) {
+			probe.pos = canopy[i & (nrInputs - 1)];
+			res += terrain.sweep(makeDroneProbe(probe), moves[i & (nrInputs - 1)]).hit ? 1 : 0;
+		}
+		return res;
+	} });
+
+	benches.push_back({ "terrain_get_y", [&](size_t n) {
+		size_t res = 0;
+		for (size_t i = 0; i < n; i++) {
+			const glm::vec3 &pos = canopy[i & (nrInputs - 1)];
+			res += bits(terrain.getTerrainY(pos.x, pos.z));
+		}
+		return res;
+	} });
+
+	benches.push_back({ "terrain_check_pos", [&](size_t n) {
+		size_t res = 0;
+		for (size_t i = 0; i < n; i++) {
+			res += terrain.checkPosition(candidates[i & (nrInputs - 1)]) ? 1 : 0;
+		}
+		return res;
+	} });
+
+	ThreadPool pool(threads);
+
+	for (int size : sizes) {
+		sim::WorldConfig sized = config;
+		sized.sizeX = sized.sizeZ = size;
+
+		benches.push_back({ "terrain_generate_" + std::to_string(size), [&, sized](size_t n) {
+			size_t res = 0;
+			for (size_t i = 0; i < n; i++) {
+				Terrain world;
+				world.generate(sized.sizeX, sized.sizeZ, sized.getNrObstacles(), seed, &pool);
+				res += world.getStaticItems().size();
+			}
+			return res;
+		} });
+	}
+
+	benches.push_back({ "mesh_merge_large", [&](size_t n) {
+		size_t res = 0;
+		for (size_t i = 0; i < n; i++) {
+			res += MeshData::merge({ large, large, large }).indices.size();
+		}
+		return res;
+	} });
+
+	benches.push_back({ "mesh_append_many", [&](size_t n) {
+		size_t res = 0;
+		for (size_t i = 0; i < n; i++) {
+			MeshData all;
+			for (int part = 0; part < 1000; part++) {
+				all.append(small);
+			}
+			res += all.vertices.size();
+		}
+		return res;
+	} });
+
+	benches.push_back({ "drone_blade_matrices", [&](size_t n) {
+		size_t res = 0;
+		for (size_t i = 0; i < n; i++) {
+			drone.bladeAngle += 0.1f;
+			res += bits(drone.getBladeMatrices()[0][3][0]);
+		}
+		return res;
+	} });
+
+	// Alternating directions keep the camera from drifting
+	auto cameraBench = [](void (implemented::GameCamera::*rotate)(float)) {
+		return [rotate](size_t n) {
+			implemented::GameCamera camera(glm::vec3(0, 2, 3.5f), glm::vec3(0, 1, 0), glm::vec3(0, 1, 0));
+
+			for (size_t i = 0; i < n; i++) {
+				(camera.*rotate)((i & 1) ? 0.01f : -0.01f);
+			}
+			return bits(camera.forward.x);
+		};
+	};
+
+	benches.push_back({ "camera_first_person_ox", cameraBench(&implemented::GameCamera::RotateFirstPerson_OX) });
+	benches.push_back({ "camera_first_person_oy", cameraBench(&implemented::GameCamera::RotateFirstPerson_OY) });
+	benches.push_back({ "camera_first_person_oz", cameraBench(&implemented::GameCamera::RotateFirstPerson_OZ) });
+	benches.push_back({ "camera_third_person_ox", cameraBench(&implemented::GameCamera::RotateThirdPerson_OX) });
+	benches.push_back({ "camera_third_person_oy", cameraBench(&implemented::GameCamera::RotateThirdPerson_OY) });
+	benches.push_back({ "camera_third_person_oz", cameraBench(&implemented::GameCamera::RotateThirdPerson_OZ) });
+
+	std::vector<Result> results;
+	for (auto &&bench : benches) {
+		if (!filter.empty() && bench.name.find(filter) == std::string::npos) {
+			continue;
+		}
+
+		results.push_back(measure(bench, repetitions, minMs));
+		std::fprintf(stderr, "%-26s %12.1f ns\n", bench.name.c_str(), results.back().nsPerOp);
+	}
+
+	FILE *out = outPath.empty() ? stdout : std::fopen(outPath.c_str(), "w");
+	if (out == nullptr) {
+		std::fprintf(stderr, "cannot write %s\n", outPath.c_str());
+		return EXIT_FAILURE;
+	}
+
+	writeResults(out, seed, mismatches, results);
+	if (out != stdout) {
+		std::fclose(out);
+	}
+
+	if (baselinePath.empty()) {
+		return EXIT_SUCCESS;
+	}
+
+	std::map<std::string, double> baseline;
+	if (!readBaseline(baselinePath, baseline)) {
+		std::fprintf(stderr, "cannot read %s\n", baselinePath.c_str());
+		return EXIT_FAILURE;
+	}
+
+	return (compare(baseline, results, threshold) > 0) ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+#endif
@@ -0,0 +1,143 @@
+/*
+ * Replays an input trace recorded by the game (F5) without a window and
+ * checks that it ends where the recording did: same drone position and
+ * angle, same score, same number of ticks.
+ *
+ *   tema2_replay <trace> [--realtime]
+ *
+ * Frames are replayed as fast as possible, or with --realtime at the pace
+ * they were recorded at. Either way the time the simulation took on each
+ * frame is collected, and printed as percentiles with the world starts
+ * apart. The exit code is 1 if the replay did not match the recording
+ */
+
+#ifdef TEMA2_SIM_TOOLS
+
+#include "inputTrace.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+
+using namespace sim;
+
+typedef std::chrono::steady_clock Clock;
+
+static double elapsedMs(Clock::time_point start)
+{
+	return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+static void printTimes(const char *name, const FrameTimes &times)
+{
+	auto s = times.summarize();
+	std::printf("%-8s %8zu %9.3f %9.3f %9.3f %9.3f %9.3f\n",
+		name, times.size(), s.mean, s.p50, s.p95, s.p99, s.max);
+}
+
+int main(int argc, char **argv)
+{
+	std::string path;
+	bool realtime = false;
+
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+
+		if (arg == "--realtime") {
+			realtime = true;
+		} else if (path.empty() && arg.compare(0, 2, "--") != 0) {
+			path = arg;
+		} else {
+			std::fprintf(stderr, "bad argument %s\n", arg.c_str());
+			return EXIT_FAILURE;
+		}
+	}
+
+	TraceReader trace;
+	if (path.empty() || !trace.open(path)) {
+		std::fprintf(stderr, "usage: tema2_replay <trace> [--realtime]\n");
+		return EXIT_FAILURE;
+	}
+
+	Simulation simulation;
+	bool started = false;
+	bool ended = false;
+	TraceEnd expected;
+
+	FrameTimes frameTimes;
+	FrameTimes worldTimes;
+
+	// Recorded time since the start, what the real time pace follows
+	double traceMs = 0;
+	auto replayStart = Clock::now();
+
+	TraceEvent event;
+	while (!ended && trace.next(event)) {
+		switch (event.kind) {
+		case TRACE_WORLD: {
+			auto start = Clock::now();
+			startTraceWorld(simulation, event);
+			worldTimes.add(static_cast<float>(elapsedMs(start)));
+
+			started = true;
+			break;
+		}
+		case TRACE_FRAME: {
+			if (!started) {
+				break;
+			}
+
+			traceMs += event.deltaTime * 1000.0;
+			if (realtime) {
+				std::this_thread::sleep_until(replayStart
+					+ std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double, std::milli>(traceMs)));
+			}
+
+			auto start = Clock::now();
+			simulation.advance(event.input, event.deltaTime);
+			frameTimes.add(static_cast<float>(elapsedMs(start)));
+			break;
+		}
+		case TRACE_END:
+			expected = event.end;
+			ended = true;
+			break;
+		default:
+			// Keys and mouse moves only drive the camera of the game
+			break;
+		}
+	}
+
+	double wallMs = elapsedMs(replayStart);
+
+	if (!started) {
+		std::fprintf(stderr, "%s: no world in the trace\n", path.c_str());
+		return EXIT_FAILURE;
+	}
+
+	std::printf("%zu frames, %.1f s recorded, replayed in %.1f s%s\n",
+		frameTimes.size(), traceMs / 1000.0, wallMs / 1000.0, realtime ? " (real time)" : "");
+	std::printf("ms       %8s %9s %9s %9s %9s %9s\n", "count", "mean", "p50", "p95", "p99", "max");
+	printTimes("frame", frameTimes);
+	printTimes("world", worldTimes);
+
+	if (!ended) {
+		std::printf("trace cut short, nothing to compare against\n");
+		return EXIT_FAILURE;
+	}
+
+	TraceEnd got = traceEnd(simulation);
+	std::printf("recorded: pos %.6f %.6f %.6f angle %.6f score %d ticks %llu\n",
+		expected.pos.x, expected.pos.y, expected.pos.z, expected.angle, expected.score, expected.ticks);
+	std::printf("replayed: pos %.6f %.6f %.6f angle %.6f score %d ticks %llu\n",
+		got.pos.x, got.pos.y, got.pos.z, got.angle, got.score, got.ticks);
+
+	bool match = (got == expected);
+	std::printf("%s\n", match ? "MATCH" : "MISMATCH");
+
+	return match ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+#endif
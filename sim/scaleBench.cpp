@@ -0,0 +1,237 @@
+/*
+ * Sweeps square worlds over sizes and obstacle densities and reports, for
+ * each one, what it costs to build and to play in it:
+ *
+ *   gen ms    Terrain::generate() on the given number of threads
+ *   MB        memory held by the terrain, Terrain::memoryUsage()
+ *   hit ns    one Terrain::hit() at a random position under the ceiling
+ *   sweep ns  one Terrain::sweep() over a fast tick, in a random direction
+ *   cull us   culling of one frame from a random camera, and gathering the
+ *             visible chunks and obstacle matrices the way the game does
+ *   draws     draw calls that frame would submit, KB the instance data
+ *   map       the same for the top-down minimap redraw, over the whole world
+ *
+ *   tema2_scale_bench [--sizes 100,250,500,1000,1500,2000] [--densities 80,40,20]
+ *                     [--threads N] [--seed S] [--queries Q] [--frames F]
+ *                     [--config <file>] [--<world key> <value>]
+ *
+ * Densities are in tiles per obstacle, world keys are the ones of
+ * sim::WorldConfig (the ceiling is used, the size is swept)
+ */
+
+#ifdef TEMA2_SIM_TOOLS
+
+#include "simulation.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+#include <random>
+#include <sstream>
+#include <algorithm>
+
+using namespace obj3D;
+
+typedef std::chrono::steady_clock Clock;
+
+static double elapsedMs(Clock::time_point start)
+{
+	return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+static bool parseList(const std::string &value, std::vector<int> &res)
+{
+	res.clear();
+
+	std::stringstream in(value);
+	std::string item;
+
+	while (std::getline(in, item, ',')) {
+		int v = std::atoi(item.c_str());
+		if (v <= 0) {
+			return false;
+		}
+		res.push_back(v);
+	}
+
+	return !res.empty();
+}
+
+/**
+ * What the game collects in cullScene() for one pass
+ */
+struct FrameCost {
+	double us = 0;
+	size_t draws = 0;
+	size_t instanceBytes = 0;
+};
+
+static FrameCost cullFrame(const Terrain &terrain, const glm::mat4 &viewProjection)
+{
+	std::vector<unsigned int> chunks;
+	std::vector<std::vector<glm::mat4>> visible(terrain.getObstacleGroups().size());
+	auto &groups = terrain.getObstacleGroups();
+
+	auto start = Clock::now();
+
+	terrain.cull(Frustum(viewProjection), [&](const StaticItem &item) {
+		if (item.kind == StaticItem::CHUNK) {
+			chunks.push_back(item.index);
+		} else {
+			visible[item.group].push_back(groups[item.group].matrices[item.index]);
+		}
+	});
+
+	FrameCost cost;
+	cost.us = elapsedMs(start) * 1000.0;
+
+	// One draw per chunk and one per non empty group
+	cost.draws = chunks.size();
+	for (auto &&matrices : visible) {
+		cost.draws += matrices.empty() ? 0 : 1;
+		cost.instanceBytes += matrices.size() * sizeof(glm::mat4);
+	}
+
+	return cost;
+}
+
+int main(int argc, char **argv)
+{
+	std::vector<int> sizes = { 100, 250, 500, 1000, 1500, 2000 };
+	std::vector<int> densities = { 80, 40, 20 };
+	unsigned int threads = std::thread::hardware_concurrency();
+	unsigned int seed = 42;
+	int queries = 100000;
+	int frames = 200;
+
+	// Everything the bench does not know goes to the world config
+	std::vector<char *> worldArgs = { argv[0] };
+
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		bool ok = (i + 1 < argc);
+
+		if (ok && arg == "--sizes") {
+			ok = parseList(argv[++i], sizes);
+		} else if (ok && arg == "--densities") {
+			ok = parseList(argv[++i], densities);
+		} else if (ok && arg == "--threads") {
+			threads = std::strtoul(argv[++i], nullptr, 10);
+		} else if (ok && arg == "--seed") {
+			seed = std::strtoul(argv[++i], nullptr, 10);
+		} else if (ok && arg == "--queries") {
+			queries = std::max(1, std::atoi(argv[++i]));
+		} else if (ok && arg == "--frames") {
+			frames = std::max(1, std::atoi(argv[++i]));
+		} else {
+			worldArgs.push_back(argv[i]);
+		}
+
+		if (!ok) {
+			std::fprintf(stderr, "bad argument %s\n", arg.c_str());
+			return EXIT_FAILURE;
+		}
+	}
+
+	sim::WorldConfig config;
+	if (!config.parseArgs(static_cast<int>(worldArgs.size()), worldArgs.data())) {
+		std::fprintf(stderr, "bad world arguments\n");
+		return EXIT_FAILURE;
+	}
+
+	ThreadPool pool(threads);
+
+	std::printf("seed %u, %u threads, %d queries, %d frames, ceiling %d\n",
+		seed, pool.size(), queries, frames, config.maxY);
+	std::printf("  size  t/obs  obstacles   gen ms       MB   hit ns sweep ns   cull us  draws  inst KB"
+		"    map us  map draws   map KB\n");
+
+	glm::mat4 projection = glm::perspective(RADIANS(60), 16.f / 9.f, 0.01f, 200.0f);
+
+	for (int size : sizes) {
+		for (int density : densities) {
+			config.sizeX = size;
+			config.sizeZ = size;
+			config.tilesPerObstacle = density;
+
+			Terrain terrain;
+
+			auto start = Clock::now();
+			terrain.generate(config.sizeX, config.sizeZ, config.getNrObstacles(), seed, &pool);
+			double genMs = elapsedMs(start);
+
+			// Same positions for every world of the same size
+			std::mt19937 gen(seed);
+			std::uniform_real_distribution<float> distXZ(-size / 2.f, size / 2.f);
+			std::uniform_real_distribution<float> distY(0.f, config.maxY * 0.4f);
+			std::uniform_real_distribution<float> distAngle(0.f, 2.f * glm::pi<float>());
+
+			Drone drone;
+			drone.size = DRONE_SIZE;
+
+			std::vector<glm::vec3> positions(queries);
+			std::vector<glm::vec3> moves(queries);
+			for (int i = 0; i < queries; i++) {
+				positions[i] = glm::vec3(distXZ(gen), distY(gen), distXZ(gen));
+
+				float angle = distAngle(gen);
+				moves[i] = glm::vec3(std::cos(angle), 0, std::sin(angle)) * (3.f * MAP_SIZE_Y / 5.f * SIM_TICK);
+			}
+
+			size_t nrHits = 0;
+
+			start = Clock::now();
+			for (int i = 0; i < queries; i++) {
+				drone.pos = positions[i];
+				nrHits += terrain.hit(drone) ? 1 : 0;
+			}
+			double hitNs = elapsedMs(start) * 1e6 / queries;
+
+			start = Clock::now();
+			for (int i = 0; i < queries; i++) {
+				drone.pos = positions[i];
+				nrHits += terrain.sweep(makeDroneProbe(drone), moves[i]).hit ? 1 : 0;
+			}
+			double sweepNs = elapsedMs(start) * 1e6 / queries;
+
+			FrameCost frame;
+			for (int i = 0; i < frames; i++) {
+				glm::vec3 eye(distXZ(gen), 0, distXZ(gen));
+				eye.y = terrain.getTerrainY(eye.x, eye.z) + 1.f + distY(gen);
+
+				float angle = distAngle(gen);
+				glm::vec3 fwd(std::cos(angle), -0.15f, std::sin(angle));
+
+				FrameCost cost = cullFrame(terrain, projection * glm::lookAt(eye, eye + fwd, glm::vec3(0, 1, 0)));
+				frame.us += cost.us / frames;
+				frame.draws += cost.draws;
+				frame.instanceBytes += cost.instanceBytes;
+			}
+			frame.draws /= frames;
+			frame.instanceBytes /= frames;
+
+			// Top-down over the whole world, as in DroneGame::setMinimapCamera()
+			glm::mat4 minimap = glm::ortho(-size / 2.f, size / 2.f, -size / 2.f, size / 2.f, 0.1f, 100.0f)
+				* glm::lookAt(glm::vec3(0, 25.f, 0), glm::vec3(0), glm::vec3(0, 0, -1));
+			FrameCost map = cullFrame(terrain, minimap);
+
+			std::printf("%6d %6d %10d %8.1f %8.1f %8.1f %8.1f %9.1f %6zu %8.1f %9.1f %10zu %8.1f\n",
+				size, density, config.getNrObstacles(), genMs, terrain.memoryUsage() / (1024.0 * 1024.0),
+				hitNs, sweepNs, frame.us, frame.draws, frame.instanceBytes / 1024.0,
+				map.us, map.draws, map.instanceBytes / 1024.0);
+			std::fflush(stdout);
+
+			// Keeps the queries from being optimized out
+			if (nrHits == static_cast<size_t>(-1)) {
+				std::printf("\n");
+			}
+		}
+	}
+
+	return EXIT_SUCCESS;
+}
+
+#endif
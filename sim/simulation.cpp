@@ -0,0 +1,297 @@
+#include "simulation.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace sim;
+
+void Simulation::resetState()
+{
+	score = 0;
+	deliveries = 0;
+
+	tickCount = 0;
+	accumulator = 0;
+
+	drone.pos = glm::vec3(0, 5, 0);
+	drone.size = DRONE_SIZE;
+
+	drone.angle = 0;
+	drone.bladeAngle = 0;
+
+	drone.target = nullptr;
+}
+
+void Simulation::setConfig(const WorldConfig &config)
+{
+	this->config = config;
+
+	// The ceiling holds right away, the rest from the next world on
+	worldConfig.maxY = config.maxY;
+}
+
+void Simulation::setWorldConfig(const WorldConfig &built)
+{
+	worldConfig = built;
+	worldConfig.maxY = config.maxY;
+
+	if (!streaming) {
+		worldConfig.sizeX = terrain->getSizeX();
+		worldConfig.sizeZ = terrain->getSizeZ();
+	}
+}
+
+void Simulation::restart(unsigned int seed)
+{
+	dropNextWorld();
+
+	streaming = false;
+	resetState();
+	terrain->generate(config.sizeX, config.sizeZ, config.getNrObstacles(), seed, &generationPool);
+
+	setWorldConfig(config);
+}
+
+bool Simulation::restartFromSnapshot(const std::string &path)
+{
+	dropNextWorld();
+
+	if (!terrain->load(path, config.maxY, config.tilesPerObstacle)) {
+		return false;
+	}
+
+	streaming = false;
+	resetState();
+
+	setWorldConfig(config);
+	return true;
+}
+
+void Simulation::restartStreaming(unsigned int seed)
+{
+	dropNextWorld();
+
+	streaming = true;
+	resetState();
+
+	streamer.start(seed);
+	streamer.update(drone.pos);
+
+	streamTargetGen.seed(seed + 1);
+	streamTarget = streamer.pickTarget(drone.pos, streamTargetGen);
+
+	setWorldConfig(config);
+}
+
+void Simulation::dropNextWorld()
+{
+	// The pool is only used by one world at a time
+	if (nextWorld.valid()) {
+		nextWorld.wait();
+		nextWorld = {};
+	}
+	nextTerrain.reset();
+}
+
+void Simulation::prepareWorld(unsigned int seed, const std::string &snapshotPath)
+{
+	dropNextWorld();
+
+	// The config may change while the world is built
+	nextConfig = config;
+	nextWorld = std::async(std::launch::async, [this, seed, snapshotPath, config = config]() {
+		std::unique_ptr<obj3D::Terrain> world(new obj3D::Terrain());
+
+		if (snapshotPath.empty() || !world->load(snapshotPath, config.maxY, config.tilesPerObstacle)) {
+			world->generate(config.sizeX, config.sizeZ, config.getNrObstacles(), seed, &generationPool);
+
+			if (!snapshotPath.empty()) {
+				world->save(snapshotPath, config.maxY, config.tilesPerObstacle);
+			}
+		}
+
+		return world;
+	});
+}
+
+const obj3D::Terrain *Simulation::pollNextWorld()
+{
+	if (nextWorld.valid()
+		&& nextWorld.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+		nextTerrain = nextWorld.get();
+	}
+
+	return nextTerrain.get();
+}
+
+bool Simulation::swapWorld()
+{
+	if (pollNextWorld() == nullptr) {
+		return false;
+	}
+
+	terrain = std::move(nextTerrain);
+
+	streaming = false;
+	resetState();
+
+	setWorldConfig(nextConfig);
+	return true;
+}
+
+int Simulation::advance(const InputState &input, float deltaTime)
+{
+	accumulator += deltaTime;
+
+	int ticks = 0;
+	while (accumulator >= SIM_TICK && ticks < SIM_MAX_TICKS) {
+		step(input);
+
+		accumulator -= SIM_TICK;
+		ticks++;
+	}
+
+	if (ticks == SIM_MAX_TICKS) {
+		accumulator = 0;
+	}
+
+	return ticks;
+}
+
+void Simulation::step(const InputState &input)
+{
+	float deltaTime = SIM_TICK;
+	if (input.boost) {
+		deltaTime *= MAP_SIZE_Y / 5.f;
+	}
+
+	moveInput(input, deltaTime);
+
+	// Rotate
+	float angleStep = deltaTime * 1.5f;
+
+	if (input.rotateLeft) {
+		drone.angle += angleStep;
+	} else if (input.rotateRight) {
+		drone.angle -= angleStep;
+	}
+
+	if (streaming) {
+		updateStreaming();
+	}
+
+	drone.acquireTarget(streaming ? streamTarget : terrain->target);
+	drone.carryTarget();
+
+	if (drone.target != nullptr && drone.target->deliver()) {
+		score += static_cast<int>(std::floor(drone.target->distance));
+		deliveries++;
+
+		drone.target = nullptr;
+		if (streaming) {
+			streamTarget = streamer.pickTarget(drone.pos, streamTargetGen);
+		} else {
+			terrain->generateTarget();
+		}
+	}
+
+	tickCount++;
+}
+
+void Simulation::updateStreaming()
+{
+	glm::vec3 shift = streamer.update(drone.pos);
+	if (shift == glm::vec3(0)) {
+		return;
+	}
+
+	drone.pos -= shift;
+	streamTarget.pos -= shift;
+	streamTarget.sendPos -= shift;
+}
+
+obj3D::SweepHit Simulation::sweep(const obj3D::DroneProbe &probe, glm::vec3 dVec) const
+{
+	return streaming ? streamer.sweep(probe, dVec) : terrain->sweep(probe, dVec);
+}
+
+float Simulation::getFloorY(const obj3D::DroneProbe &probe, float x, float z) const
+{
+	return streaming ? streamer.getFloorY(probe, x, z) : terrain->getFloorY(probe, x, z);
+}
+
+glm::vec3 Simulation::keepInBounds(glm::vec3 pos) const
+{
+	glm::vec3 res = pos;
+
+	if (!streaming) {
+		float rangeX = worldConfig.sizeX / 2.f;
+		float rangeZ = worldConfig.sizeZ / 2.f;
+
+		res.x = std::max(-rangeX, pos.x);
+		res.x = std::min(rangeX, res.x);
+
+		res.z = std::max(-rangeZ, pos.z);
+		res.z = std::min(rangeZ, res.z);
+	}
+
+	res.y = std::max(getFloorY(obj3D::makeDroneProbe(drone), res.x, res.z), res.y);
+	res.y = std::min(static_cast<float>(worldConfig.maxY), res.y);
+
+	return res;
+}
+
+void Simulation::move(glm::vec3 dVec)
+{
+	auto probe = obj3D::makeDroneProbe(drone);
+
+	auto res = sweep(probe, dVec);
+	drone.pos += dVec * res.toi;
+
+	if (res.hit) {
+		probe.pos = drone.pos;
+		drone.pos += res.slide * sweep(probe, res.slide).toi;
+	}
+
+	drone.pos = keepInBounds(drone.pos);
+}
+
+void Simulation::moveInput(const InputState &input, float deltaTime)
+{
+	float step = deltaTime * 3.f;
+	float dAngle = deltaTime * 15;
+
+	auto fwd = input.forwardDir;
+	fwd.y = 0;
+	if (glm::length(fwd) > 0) {
+		fwd = glm::normalize(fwd);
+	}
+
+	// All the directions are combined and moved along at once
+	glm::vec3 dVec = glm::vec3(0);
+
+	if (input.forward) {
+		dVec += step * fwd;
+	} else if (input.backward) {
+		dVec -= step * fwd;
+	}
+
+	if (input.right) {
+		dVec += step * input.rightDir;
+	} else if (input.left) {
+		dVec -= step * input.rightDir;
+	}
+
+	if (input.up) {
+		dVec.y += 1.2f * step;
+	} else if (input.down) {
+		dVec.y -= 1.2f * step;
+	}
+
+	if (dVec != glm::vec3(0)) {
+		move(dVec);
+		dAngle = deltaTime * 25;
+	}
+
+	drone.bladeAngle += dAngle;
+}
@@ -0,0 +1,243 @@
+#pragma once
+
+#include <memory>
+#include <future>
+#include <random>
+
+#include "../3D/assets/terrain/terrain.h"
+#include "../3D/assets/terrain/worldStreamer.h"
+#include "../3D/assets/drone/drone.h"
+#include "worldConfig.h"
+
+// Length of one simulation step, in seconds
+#define SIM_TICK (1.f / 120.f)
+
+// Steps dropped after a long stall instead of catching up all at once
+#define SIM_MAX_TICKS 32
+
+namespace sim {
+
+	/**
+	 * Everything the player can do during one tick. Movement happens
+	 * in the frame given by @a forward and @a right, so the caller
+	 * decides how the controls map to the world (usually the camera)
+	 */
+	struct InputState {
+		bool forward = false;
+		bool backward = false;
+		bool right = false;
+		bool left = false;
+		bool up = false;
+		bool down = false;
+
+		bool rotateLeft = false;
+		bool rotateRight = false;
+
+		bool boost = false;
+
+		glm::vec3 forwardDir = glm::vec3(0, 0, -1);
+		glm::vec3 rightDir = glm::vec3(1, 0, 0);
+	};
+
+	/**
+	 * Game logic of the drone game, without any windowing or GPU code.
+	 * Owns the terrain, the drone and the score and only changes them
+	 * in fixed steps, so the same inputs always give the same result
+	 */
+	class Simulation {
+	public:
+		Simulation() : terrain(new obj3D::Terrain()) {}
+
+		// The drone keeps a pointer to the terrain target
+		Simulation(const Simulation &) = delete;
+		Simulation &operator=(const Simulation &) = delete;
+
+		/**
+		 * Size and density of the worlds generated from now on. The
+		 * drone is kept inside the world it is in, under @a config.maxY
+		 */
+		void setConfig(const WorldConfig &config);
+
+		inline const WorldConfig &getConfig() const
+		{
+			return config;
+		}
+
+		/**
+		 * Size, ceiling and density of the world being played: the config
+		 * it was started with, with the size of the terrain (a snapshot may
+		 * have another one) and the current ceiling
+		 */
+		inline const WorldConfig &getWorldConfig() const
+		{
+			return worldConfig;
+		}
+
+		/**
+		 * New world, drone back at the spawn point and score reset
+		 */
+		void restart(unsigned int seed);
+
+		/**
+		 * Same as restart(), with the world read from a snapshot
+		 * instead of generated. Returns false if it could not be read,
+		 * or was made for another ceiling or obstacle density
+		 */
+		bool restartFromSnapshot(const std::string &path);
+
+		/**
+		 * Same as restart(), in an endless world streamed around the drone
+		 * Blocks until the pages next to the spawn point are generated
+		 */
+		void restartStreaming(unsigned int seed);
+
+		inline bool isStreaming() const
+		{
+			return streaming;
+		}
+
+		/**
+		 * Pages of the endless world, only meaningful while streaming
+		 */
+		inline const obj3D::WorldStreamer &getStreamer() const
+		{
+			return streamer;
+		}
+
+		/**
+		 * The target the drone has to pick up or deliver, in either world
+		 */
+		inline const obj3D::Target &getTarget() const
+		{
+			return streaming ? streamTarget : terrain->target;
+		}
+
+		inline bool saveSnapshot(const std::string &path) const
+		{
+			return terrain->save(path, worldConfig.maxY, worldConfig.tilesPerObstacle);
+		}
+
+		/**
+		 * Starts building the next world on a background thread, while
+		 * the current one keeps running. It is read from @a snapshotPath
+		 * if that is a valid snapshot, otherwise generated from @a seed
+		 * and written there (unless the path is empty)
+		 * A world still being built is dropped first
+		 */
+		void prepareWorld(unsigned int seed, const std::string &snapshotPath = "");
+
+		inline bool isPreparingWorld() const
+		{
+			return nextWorld.valid() || nextTerrain != nullptr;
+		}
+
+		/**
+		 * The prepared world once it is complete, nullptr before that
+		 * Read only, it can be uploaded before being swapped in
+		 */
+		const obj3D::Terrain *pollNextWorld();
+
+		/**
+		 * Restarts like restart(), in the world given by pollNextWorld()
+		 * Returns false, changing nothing, if it is not complete yet
+		 */
+		bool swapWorld();
+
+		/**
+		 * Runs as many fixed steps as fit in the accumulated time.
+		 * Returns the number of steps taken
+		 */
+		int advance(const InputState &input, float deltaTime);
+
+		/**
+		 * Exactly one step of SIM_TICK seconds
+		 */
+		void step(const InputState &input);
+
+		inline const obj3D::Terrain &getTerrain() const
+		{
+			return *terrain;
+		}
+		inline const obj3D::Drone &getDrone() const
+		{
+			return drone;
+		}
+		inline int getScore() const
+		{
+			return score;
+		}
+
+		/**
+		 * Deliveries since the last restart, lets the caller react to new ones
+		 */
+		inline int getDeliveries() const
+		{
+			return deliveries;
+		}
+		inline unsigned long long getTickCount() const
+		{
+			return tickCount;
+		}
+
+	private:
+		std::unique_ptr<obj3D::Terrain> terrain;
+		obj3D::Drone drone;
+
+		WorldConfig config;
+		WorldConfig worldConfig;
+
+		// What the world being prepared is built with
+		WorldConfig nextConfig;
+
+		// Spreads world generation over all the cores, same world as with one
+		obj3D::ThreadPool generationPool;
+
+		// Built by prepareWorld(), after the pool that it uses
+		std::future<std::unique_ptr<obj3D::Terrain>> nextWorld;
+		std::unique_ptr<obj3D::Terrain> nextTerrain;
+
+		// Endless world, used instead of the terrain while streaming
+		obj3D::WorldStreamer streamer;
+		obj3D::Target streamTarget;
+		std::mt19937 streamTargetGen;
+		bool streaming = false;
+
+		int score = 0;
+		int deliveries = 0;
+
+		unsigned long long tickCount = 0;
+		float accumulator = 0;
+
+		void resetState();
+
+		/**
+		 * Keeps @a built as the config of the world just started
+		 */
+		void setWorldConfig(const WorldConfig &built);
+		void dropNextWorld();
+
+		void moveInput(const InputState &input, float deltaTime);
+
+		obj3D::SweepHit sweep(const obj3D::DroneProbe &probe, glm::vec3 dVec) const;
+		float getFloorY(const obj3D::DroneProbe &probe, float x, float z) const;
+
+		/**
+		 * Follows the drone with the streamed pages, and moves everything
+		 * along when the origin is moved
+		 */
+		void updateStreaming();
+
+		/**
+		 * Sweeps the drone along @a dVec, sliding once along
+		 * whatever it runs into
+		 */
+		void move(glm::vec3 dVec);
+
+		/**
+		 * The sides are the ones of the terrain, a snapshot may not have
+		 * the configured size. The endless world has no sides
+		 */
+		glm::vec3 keepInBounds(glm::vec3 pos) const;
+	};
+
+} // namespace sim
@@ -0,0 +1,151 @@
+#include "simulationThread.h"
+
+#include <algorithm>
+
+using namespace sim;
+
+SimSnapshot sim::makeSnapshot(const Simulation &simulation)
+{
+	SimSnapshot res;
+
+	res.drone = simulation.getDrone();
+	res.drone.target = nullptr;
+	res.carrying = (simulation.getDrone().target != nullptr);
+	res.target = simulation.getTarget();
+
+	res.score = simulation.getScore();
+	res.deliveries = simulation.getDeliveries();
+	res.tick = simulation.getTickCount();
+
+	return res;
+}
+
+SimSnapshot sim::lerpSnapshot(const SimSnapshot &a, const SimSnapshot &b, float alpha)
+{
+	SimSnapshot res = b;
+
+	res.drone.pos = glm::mix(a.drone.pos, b.drone.pos, alpha);
+	res.drone.angle = glm::mix(a.drone.angle, b.drone.angle, alpha);
+	res.drone.bladeAngle = glm::mix(a.drone.bladeAngle, b.drone.bladeAngle, alpha);
+
+	// Carried under the drone, or still on the ground
+	if (a.target.sendPos == b.target.sendPos && a.carrying == b.carrying) {
+		res.target.pos = glm::mix(a.target.pos, b.target.pos, alpha);
+	}
+
+	res.time = a.time + (b.time - a.time) * alpha;
+	return res;
+}
+
+SimulationThread::~SimulationThread()
+{
+	stop();
+}
+
+void SimulationThread::start(Simulation &simulation)
+{
+	stop();
+
+	this->simulation = &simulation;
+	epoch = Clock::now();
+
+	// Controls left from before belong to another world
+	InputState stale;
+	while (inputs.pop(stale)) {
+	}
+
+	// Published before the thread exists, sample() has something from the start
+	SnapshotPair &first = snapshots.back();
+	first.curr = makeSnapshot(simulation);
+	first.prev = first.curr;
+	snapshots.publish();
+
+	ticks = 0;
+	dropped = 0;
+	stepNs = 0;
+
+	thread = std::thread(&SimulationThread::run, this);
+}
+
+void SimulationThread::stop()
+{
+	if (!thread.joinable()) {
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	wake.notify_one();
+
+	thread.join();
+	stopping = false;
+}
+
+void SimulationThread::run()
+{
+	const auto tick = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(SIM_TICK));
+
+	InputState input;
+	SimSnapshot last = makeSnapshot(*simulation);
+
+	auto next = epoch;
+	std::unique_lock<std::mutex> lock(mutex);
+
+	while (true) {
+		next += tick;
+		if (wake.wait_until(lock, next, [this]() { return stopping; })) {
+			break;
+		}
+
+		// Late ticks are caught up right away, up to SIM_MAX_TICKS
+		auto now = Clock::now();
+		if (now - next > tick * SIM_MAX_TICKS) {
+			dropped += static_cast<unsigned long long>((now - next) / tick);
+			next = now;
+		}
+
+		while (inputs.pop(input)) {
+		}
+
+		auto start = Clock::now();
+		simulation->step(input);
+		stepNs += std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+		ticks++;
+
+		SnapshotPair &pair = snapshots.back();
+		pair.prev = last;
+		pair.curr = makeSnapshot(*simulation);
+		pair.curr.time = std::chrono::duration<double>(next - epoch).count();
+		snapshots.publish();
+
+		last = pair.curr;
+	}
+}
+
+SimSnapshot SimulationThread::sample()
+{
+	snapshots.acquire();
+	const SnapshotPair &pair = snapshots.front();
+
+	double now = std::chrono::duration<double>(Clock::now() - epoch).count() - SIM_TICK;
+	double span = pair.curr.time - pair.prev.time;
+
+	float alpha = 1;
+	if (span > 0) {
+		alpha = static_cast<float>(std::min(1.0, std::max(0.0, (now - pair.prev.time) / span)));
+	}
+
+	return lerpSnapshot(pair.prev, pair.curr, alpha);
+}
+
+SimulationThread::Stats SimulationThread::getStats() const
+{
+	Stats res;
+	res.ticks = ticks;
+	res.dropped = dropped;
+	res.meanStepUs = (res.ticks > 0) ? stepNs / 1000.0 / res.ticks : 0;
+
+	return res;
+}
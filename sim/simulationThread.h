@@ -0,0 +1,214 @@
+#pragma once
+
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <condition_variable>
+
+#include "simulation.h"
+
+// Inputs waiting for the simulation thread, a power of two
+#define SIM_INPUT_QUEUE 64
+
+namespace sim {
+
+	/**
+	 * What the renderer needs of one tick of the simulation
+	 * The drone has no target pointer, @a carrying tells whether it holds @a target
+	 */
+	struct SimSnapshot {
+		obj3D::Drone drone;
+		obj3D::Target target;
+		bool carrying = false;
+
+		int score = 0;
+		int deliveries = 0;
+
+		unsigned long long tick = 0;
+		// Seconds since the thread started
+		double time = 0;
+	};
+
+	SimSnapshot makeSnapshot(const Simulation &simulation);
+
+	/**
+	 * @a a moved towards @a b by @a alpha, only the poses are interpolated
+	 * The target jumps when it is a new one
+	 */
+	SimSnapshot lerpSnapshot(const SimSnapshot &a, const SimSnapshot &b, float alpha);
+
+	/**
+	 * Lock free queue between exactly one producer and one consumer thread
+	 */
+	template <typename T, size_t N>
+	class SpscQueue {
+		static_assert((N & (N - 1)) == 0, "SpscQueue size must be a power of two");
+
+	public:
+		/**
+		 * Returns false, dropping @a item, if the queue is full
+		 */
+		bool push(const T &item)
+		{
+			size_t t = tail.load(std::memory_order_relaxed);
+			if (t - head.load(std::memory_order_acquire) == N) {
+				return false;
+			}
+
+			items[t & (N - 1)] = item;
+			tail.store(t + 1, std::memory_order_release);
+			return true;
+		}
+
+		bool pop(T &item)
+		{
+			size_t h = head.load(std::memory_order_relaxed);
+			if (h == tail.load(std::memory_order_acquire)) {
+				return false;
+			}
+
+			item = items[h & (N - 1)];
+			head.store(h + 1, std::memory_order_release);
+			return true;
+		}
+
+	private:
+		T items[N];
+
+		// Apart, so that the two threads do not share a cache line
+		alignas(64) std::atomic<size_t> head{ 0 };
+		alignas(64) std::atomic<size_t> tail{ 0 };
+	};
+
+	/**
+	 * One writer and one reader passing the latest value without locking
+	 * or waiting: the writer fills the back slot and swaps it with the
+	 * middle one, the reader swaps its front slot with the middle one
+	 * whenever a newer value was published there
+	 */
+	template <typename T>
+	class TripleBuffer {
+	public:
+		inline T &back()
+		{
+			return slots[backIndex];
+		}
+
+		inline void publish()
+		{
+			backIndex = middle.exchange(backIndex | FRESH, std::memory_order_acq_rel) & INDEX;
+		}
+
+		/**
+		 * Returns true if front() changed since the last call
+		 */
+		inline bool acquire()
+		{
+			if (!(middle.load(std::memory_order_relaxed) & FRESH)) {
+				return false;
+			}
+
+			frontIndex = middle.exchange(frontIndex, std::memory_order_acq_rel) & INDEX;
+			return true;
+		}
+
+		inline const T &front() const
+		{
+			return slots[frontIndex];
+		}
+
+	private:
+		static const uint8_t INDEX = 3;
+		static const uint8_t FRESH = 4;
+
+		T slots[3];
+
+		std::atomic<uint8_t> middle{ 1 };
+		uint8_t backIndex = 0;
+		uint8_t frontIndex = 2;
+	};
+
+	/**
+	 * Steps a simulation every SIM_TICK seconds of real time on a thread
+	 * of its own, whatever the frame rate
+	 *
+	 * Controls come in through a lock free queue, the latest ones are held
+	 * until newer arrive. Every tick publishes its snapshot with the one
+	 * before through a triple buffer, the renderer draws one tick in the
+	 * past, between the two. Neither side ever waits for the other
+	 */
+	class SimulationThread {
+	public:
+		SimulationThread() {}
+		~SimulationThread();
+
+		SimulationThread(const SimulationThread &) = delete;
+		SimulationThread &operator=(const SimulationThread &) = delete;
+
+		/**
+		 * Nothing else may touch @a simulation until stop()
+		 */
+		void start(Simulation &simulation);
+
+		/**
+		 * Waits for the tick being run, the simulation is the caller's again
+		 */
+		void stop();
+
+		inline bool isRunning() const
+		{
+			return thread.joinable();
+		}
+
+		/**
+		 * Controls held from the next tick on, dropped if
+		 * SIM_INPUT_QUEUE inputs are still waiting
+		 */
+		inline void pushInput(const InputState &input)
+		{
+			inputs.push(input);
+		}
+
+		/**
+		 * State one tick in the past, interpolated between the last two
+		 * ticks. Only to be called from one thread
+		 */
+		SimSnapshot sample();
+
+		struct Stats {
+			unsigned long long ticks = 0;
+			// Dropped after the thread fell SIM_MAX_TICKS behind
+			unsigned long long dropped = 0;
+			double meanStepUs = 0;
+		};
+
+		Stats getStats() const;
+
+	private:
+		struct SnapshotPair {
+			SimSnapshot prev;
+			SimSnapshot curr;
+		};
+
+		typedef std::chrono::steady_clock Clock;
+
+		Simulation *simulation = nullptr;
+		std::thread thread;
+
+		std::mutex mutex;
+		std::condition_variable wake;
+		bool stopping = false;
+
+		SpscQueue<InputState, SIM_INPUT_QUEUE> inputs;
+		TripleBuffer<SnapshotPair> snapshots;
+		Clock::time_point epoch;
+
+		std::atomic<unsigned long long> ticks{ 0 };
+		std::atomic<unsigned long long> dropped{ 0 };
+		std::atomic<unsigned long long> stepNs{ 0 };
+
+		void run();
+	};
+
+} // namespace sim
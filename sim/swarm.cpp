@@ -0,0 +1,300 @@
+#include "swarm.h"
+
+#include <cmath>
+#include <chrono>
+#include <algorithm>
+
+using namespace sim;
+
+// Size of the carried targets, same as the one of the player
+#define SWARM_TARGET_SIZE 0.3f
+
+// Random spots tried before one inside an obstacle is kept anyway
+#define SWARM_SPOT_TRIES 8
+
+void Swarm::reset(const obj3D::Terrain &terrain, size_t count, unsigned int seed, float maxY)
+{
+	this->terrain = &terrain;
+	this->maxY = maxY;
+	accumulator = 0;
+	stats = Stats();
+
+	obj3D::Target target;
+	target.size = SWARM_TARGET_SIZE;
+
+	obj3D::Drone drone;
+	drone.size = DRONE_SIZE;
+
+	emptyProbe = obj3D::makeDroneProbe(drone);
+	drone.target = &target;
+	carryProbe = obj3D::makeDroneProbe(drone);
+
+	for (auto *field : { &posX, &posY, &posZ, &angle, &bladeAngle, &pickupX, &pickupZ, &sendX, &sendZ }) {
+		field->assign(count, 0.f);
+	}
+	carrying.assign(count, 0);
+	detour.assign(count, 0);
+	detourDir.assign(count, 0);
+	rng.resize(count);
+
+	batchDeliveries.assign(getNrBatches(), 0);
+
+	for (size_t i = 0; i < count; i++) {
+		// splitmix32 of the index, never 0 so that xorshift does not get stuck
+		uint32_t h = seed + static_cast<uint32_t>(i) * 0x9e3779b9u;
+		h = (h ^ (h >> 16)) * 0x85ebca6bu;
+		h = (h ^ (h >> 13)) * 0xc2b2ae35u;
+		rng[i] = (h ^ (h >> 16)) | 1;
+
+		glm::vec2 start = randomSpot(i);
+		posX[i] = start.x;
+		posZ[i] = start.y;
+		posY[i] = terrain.getFloorY(emptyProbe, start.x, start.y) + SWARM_CRUISE_Y;
+
+		bladeAngle[i] = static_cast<float>(rng[i] % 628) / 100.f;
+
+		pickSpots(i);
+	}
+}
+
+void Swarm::clear()
+{
+	terrain = nullptr;
+
+	for (auto *field : { &posX, &posY, &posZ, &angle, &bladeAngle, &pickupX, &pickupZ, &sendX, &sendZ }) {
+		field->clear();
+	}
+	carrying.clear();
+	detour.clear();
+	detourDir.clear();
+	rng.clear();
+	batchDeliveries.clear();
+}
+
+int Swarm::advance(float deltaTime, obj3D::ThreadPool *pool)
+{
+	accumulator += deltaTime;
+
+	int nrTicks = 0;
+	while (accumulator >= SWARM_TICK && nrTicks < SWARM_MAX_TICKS) {
+		step(pool);
+
+		accumulator -= SWARM_TICK;
+		nrTicks++;
+	}
+
+	// Far behind, the rest is dropped
+	if (nrTicks == SWARM_MAX_TICKS) {
+		accumulator = std::min(accumulator, SWARM_TICK);
+	}
+
+	return nrTicks;
+}
+
+void Swarm::step(obj3D::ThreadPool *pool)
+{
+	if (terrain == nullptr || size() == 0) {
+		return;
+	}
+
+	auto start = std::chrono::steady_clock::now();
+
+	size_t count = size();
+	obj3D::parallelFor(pool, getNrBatches(), [this, count](size_t batch) {
+		size_t end = std::min(count, (batch + 1) * SWARM_BATCH);
+		unsigned int deliveries = 0;
+
+		for (size_t i = batch * SWARM_BATCH; i < end; i++) {
+			stepDrone(i, deliveries);
+		}
+
+		batchDeliveries[batch] = deliveries;
+	});
+
+	for (unsigned int deliveries : batchDeliveries) {
+		stats.deliveries += deliveries;
+	}
+
+	stats.ticks++;
+	stats.droneTicks += count;
+	stats.stepSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+/**
+ * Same moves as the player: a sweep, then a slide along what was hit.
+ * Flies high on the way and lands on the spots. A drone that gets
+ * stuck climbs for a while, one that cannot climb either (under a
+ * canopy) goes a random way out instead
+ */
+void Swarm::stepDrone(size_t i, unsigned int &deliveries)
+{
+	float step = SWARM_TICK * 3.f;
+	float upStep = 1.2f * step;
+
+	bool carry = (carrying[i] != 0);
+	obj3D::DroneProbe probe = carry ? carryProbe : emptyProbe;
+
+	glm::vec3 pos(posX[i], posY[i], posZ[i]);
+	glm::vec2 toGoal = carry ? glm::vec2(sendX[i], sendZ[i]) : glm::vec2(pickupX[i], pickupZ[i]);
+	toGoal -= glm::vec2(pos.x, pos.z);
+
+	float dist = glm::length(toGoal);
+	float floorY = terrain->getFloorY(probe, pos.x, pos.z);
+
+	glm::vec3 dVec = glm::vec3(0);
+
+	// Straight up, or one of 8 directions around
+	bool detouring = (detour[i] > 0);
+	if (detouring) {
+		detour[i]--;
+
+		if (detourDir[i] == 0) {
+			dVec.y = upStep;
+		} else {
+			float dirAngle = RADIANS(45) * detourDir[i];
+			dVec.x = std::cos(dirAngle) * step;
+			dVec.z = std::sin(dirAngle) * step;
+		}
+	} else {
+		if (dist > 0) {
+			float d = std::min(dist, step);
+			dVec.x = toGoal.x / dist * d;
+			dVec.z = toGoal.y / dist * d;
+		}
+
+		// Only goes down over the spot, whatever it climbed over stays under it
+		float wantedY = (dist < SWARM_CRUISE_Y) ? floorY : std::max(pos.y, floorY + SWARM_CRUISE_Y);
+		dVec.y = std::max(-upStep, std::min(upStep, wantedY - pos.y));
+	}
+
+	// By a roof or a canopy over the spot rather than the ground
+	bool blocked = false;
+
+	if (dVec != glm::vec3(0)) {
+		glm::vec3 start = pos;
+
+		probe.pos = pos;
+		auto res = terrain->sweep(probe, dVec);
+		pos += dVec * res.toi;
+
+		if (res.hit) {
+			probe.pos = pos;
+			pos += res.slide * terrain->sweep(probe, res.slide).toi;
+
+			blocked = true;
+
+			// Less than half the way, even after sliding
+			if (glm::distance(start, pos) < 0.5f * glm::length(dVec)) {
+				detour[i] = SWARM_DETOUR_TICKS;
+				detourDir[i] = detouring ? 1 + nextRandom(i) % 8 : 0;
+			}
+		}
+
+		if (dVec.x != 0 || dVec.z != 0) {
+			angle[i] = std::atan2(-dVec.x, -dVec.z);
+		}
+	}
+
+	float rangeX = terrain->getSizeX() / 2.f;
+	float rangeZ = terrain->getSizeZ() / 2.f;
+
+	pos.x = std::max(-rangeX, std::min(rangeX, pos.x));
+	pos.z = std::max(-rangeZ, std::min(rangeZ, pos.z));
+
+	floorY = terrain->getFloorY(probe, pos.x, pos.z);
+	pos.y = std::min(maxY, std::max(floorY, pos.y));
+
+	posX[i] = pos.x;
+	posY[i] = pos.y;
+	posZ[i] = pos.z;
+
+	bladeAngle[i] += SWARM_TICK * 25;
+
+	// Landed on the spot, or on whatever covers it
+	if (dist < SWARM_REACH && (blocked || pos.y - floorY < SWARM_REACH)) {
+		if (carry) {
+			carrying[i] = 0;
+			deliveries++;
+			pickSpots(i);
+		} else {
+			carrying[i] = 1;
+		}
+	}
+}
+
+void Swarm::pickSpots(size_t i)
+{
+	glm::vec2 pickup = randomSpot(i);
+	glm::vec2 send = randomSpot(i);
+
+	// Deliveries at least as far as the ones of the player
+	for (int tries = 1; tries < SWARM_SPOT_TRIES && glm::distance(pickup, send) < 5; tries++) {
+		send = randomSpot(i);
+	}
+
+	pickupX[i] = pickup.x;
+	pickupZ[i] = pickup.y;
+	sendX[i] = send.x;
+	sendZ[i] = send.y;
+}
+
+/**
+ * xorshift32, the state of a drone is never 0
+ */
+uint32_t Swarm::nextRandom(size_t i)
+{
+	uint32_t x = rng[i];
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	rng[i] = x;
+
+	return x;
+}
+
+glm::vec2 Swarm::randomSpot(size_t i)
+{
+	float rangeX = terrain->getSizeX() / 2.f * 9.f / 10.f;
+	float rangeZ = terrain->getSizeZ() / 2.f * 9.f / 10.f;
+
+	auto next = [this, i]() {
+		return static_cast<float>(nextRandom(i)) / 4294967296.f * 2.f - 1.f;
+	};
+
+	glm::vec2 spot(0);
+	for (int tries = 0; tries < SWARM_SPOT_TRIES; tries++) {
+		spot = glm::vec2(next() * rangeX, next() * rangeZ);
+
+		obj3D::ObstacleDesc mock = { obj3D::OBSTACLE_BUILDING, spot.x, spot.y,
+			SWARM_TARGET_SIZE * 3.f / 10.f, SWARM_TARGET_SIZE / 2.f };
+		if (terrain->checkPosition(mock)) {
+			break;
+		}
+	}
+
+	return spot;
+}
+
+void Swarm::getMatrices(std::vector<glm::mat4> &bases, std::vector<glm::mat4> &blades,
+	obj3D::ThreadPool *pool) const
+{
+	size_t count = size();
+	bases.resize(count);
+	blades.resize(count * DRONE_NR_BLADES);
+
+	obj3D::parallelFor(pool, getNrBatches(), [&, count](size_t batch) {
+		size_t end = std::min(count, (batch + 1) * SWARM_BATCH);
+
+		obj3D::Drone drone;
+		drone.size = DRONE_SIZE;
+
+		for (size_t i = batch * SWARM_BATCH; i < end; i++) {
+			drone.pos = glm::vec3(posX[i], posY[i], posZ[i]);
+			drone.angle = angle[i];
+			drone.bladeAngle = bladeAngle[i];
+
+			bases[i] = drone.getBaseMatrix();
+			drone.getBladeMatrices(&blades[i * DRONE_NR_BLADES]);
+		}
+	});
+}
@@ -0,0 +1,157 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+#include "../3D/threadPool.h"
+#include "../3D/assets/terrain/terrain.h"
+#include "../3D/assets/drone/drone.h"
+
+// Drones of the swarm mode, K toggles it in the game
+#define SWARM_DEFAULT_SIZE 10000
+
+// The swarm is stepped slower than the player, it is only looked at
+#define SWARM_TICK (1.f / 30.f)
+#define SWARM_MAX_TICKS 4
+
+// Drones stepped by one job of the pool
+#define SWARM_BATCH 256
+
+// Cruise height above the ground, and how close to a spot counts as on it
+#define SWARM_CRUISE_Y 2.5f
+#define SWARM_REACH 0.4f
+
+// Ticks spent going around something the drone ran into
+#define SWARM_DETOUR_TICKS 15
+
+namespace sim {
+
+	/**
+	 * Many autonomous drones flying deliveries in a fixed world, apart
+	 * from the player: each one flies to a pickup spot, then to where
+	 * it delivers, then picks new spots, forever
+	 *
+	 * The state is kept as one array per field, and every tick is run
+	 * in batches of SWARM_BATCH drones on the pool. A drone only reads
+	 * the terrain and its own state, each has its own random generator,
+	 * so the result does not depend on the number of threads
+	 * Drones go through each other, only the terrain stops them
+	 */
+	class Swarm {
+	public:
+		Swarm() {}
+
+		Swarm(const Swarm &) = delete;
+		Swarm &operator=(const Swarm &) = delete;
+
+		/**
+		 * @a count drones spread over @a terrain, kept under @a maxY
+		 * The terrain must outlive the swarm, or the next reset()
+		 */
+		void reset(const obj3D::Terrain &terrain, size_t count, unsigned int seed, float maxY);
+
+		/**
+		 * No drones and no terrain
+		 */
+		void clear();
+
+		inline size_t size() const
+		{
+			return posX.size();
+		}
+
+		/**
+		 * Runs as many ticks as fit in the accumulated time, SWARM_MAX_TICKS
+		 * at most. Returns the number of ticks taken
+		 */
+		int advance(float deltaTime, obj3D::ThreadPool *pool);
+
+		/**
+		 * Exactly one tick of SWARM_TICK seconds
+		 */
+		void step(obj3D::ThreadPool *pool);
+
+		/**
+		 * Model matrices of every base, and of the DRONE_NR_BLADES blades
+		 * of every drone one after the other, built on the pool
+		 */
+		void getMatrices(std::vector<glm::mat4> &bases, std::vector<glm::mat4> &blades,
+			obj3D::ThreadPool *pool) const;
+
+		inline glm::vec3 getPos(size_t i) const
+		{
+			return glm::vec3(posX[i], posY[i], posZ[i]);
+		}
+
+		inline bool isCarrying(size_t i) const
+		{
+			return carrying[i] != 0;
+		}
+
+		struct Stats {
+			unsigned long long ticks = 0;
+			unsigned long long droneTicks = 0;
+			unsigned long long deliveries = 0;
+
+			// Spent in step(), the matrices are not counted
+			double stepSeconds = 0;
+
+			inline double droneTicksPerSecond() const
+			{
+				return (stepSeconds > 0) ? droneTicks / stepSeconds : 0;
+			}
+		};
+
+		inline const Stats &getStats() const
+		{
+			return stats;
+		}
+
+	private:
+		const obj3D::Terrain *terrain = nullptr;
+		float maxY = 0;
+		float accumulator = 0;
+
+		// Probes of a drone with and without a target, moved to every drone
+		obj3D::DroneProbe emptyProbe;
+		obj3D::DroneProbe carryProbe;
+
+		std::vector<float> posX;
+		std::vector<float> posY;
+		std::vector<float> posZ;
+		std::vector<float> angle;
+		std::vector<float> bladeAngle;
+
+		std::vector<float> pickupX;
+		std::vector<float> pickupZ;
+		std::vector<float> sendX;
+		std::vector<float> sendZ;
+
+		std::vector<uint8_t> carrying;
+
+		// Ticks left of the detour, and its direction, see stepDrone()
+		std::vector<uint8_t> detour;
+		std::vector<uint8_t> detourDir;
+		std::vector<uint32_t> rng;
+
+		// Deliveries of every batch in the last tick
+		std::vector<unsigned int> batchDeliveries;
+
+		Stats stats;
+
+		inline size_t getNrBatches() const
+		{
+			return (size() + SWARM_BATCH - 1) / SWARM_BATCH;
+		}
+
+		void stepDrone(size_t i, unsigned int &deliveries);
+		uint32_t nextRandom(size_t i);
+
+		/**
+		 * New pickup and delivery spots for drone @a i, away from the obstacles
+		 */
+		void pickSpots(size_t i);
+		glm::vec2 randomSpot(size_t i);
+	};
+
+} // namespace sim
@@ -0,0 +1,156 @@
+/*
+ * Steps a swarm of drones in a generated world with 1 to N threads and
+ * checks that every thread count ends in exactly the same state.
+ *
+ *   tema2_swarm_bench [--drones D] [--ticks T] [--threads N] [--size S]
+ *                     [--seed S]
+ *
+ * The world is size x size tiles with the game's obstacle density. Prints
+ * one line per thread count: drone-ticks per second of the ticks, and the
+ * time to build the matrices drawn every frame, both the best of 3 runs.
+ */
+
+#ifdef TEMA2_SIM_TOOLS
+
+#include "simulation.h"
+#include "swarm.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+#include <algorithm>
+
+using namespace sim;
+
+typedef std::chrono::steady_clock Clock;
+
+/**
+ * FNV-1a over the positions of every drone
+ */
+static uint64_t hashSwarm(const Swarm &swarm)
+{
+	uint64_t hash = 14695981039346656037ull;
+
+	for (size_t i = 0; i < swarm.size(); i++) {
+		glm::vec3 pos = swarm.getPos(i);
+		auto bytes = reinterpret_cast<const unsigned char *>(&pos);
+
+		for (size_t j = 0; j < sizeof(pos); j++) {
+			hash = (hash ^ bytes[j]) * 1099511628211ull;
+		}
+	}
+	return hash;
+}
+
+int main(int argc, char **argv)
+{
+	int nrDrones = SWARM_DEFAULT_SIZE;
+	int nrTicks = 300;
+	unsigned int maxThreads = std::thread::hardware_concurrency();
+	int size = 0;
+	unsigned int seed = 42;
+
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		bool ok = (i + 1 < argc);
+
+		if (ok && arg == "--drones") {
+			nrDrones = std::max(1, std::atoi(argv[++i]));
+		} else if (ok && arg == "--ticks") {
+			nrTicks = std::max(1, std::atoi(argv[++i]));
+		} else if (ok && arg == "--threads") {
+			maxThreads = std::strtoul(argv[++i], nullptr, 10);
+		} else if (ok && arg == "--size") {
+			size = std::atoi(argv[++i]);
+		} else if (ok && arg == "--seed") {
+			seed = std::strtoul(argv[++i], nullptr, 10);
+		} else {
+			ok = false;
+		}
+
+		if (!ok) {
+			std::fprintf(stderr, "bad argument %s\n", arg.c_str());
+			std::fprintf(stderr, "usage: tema2_swarm_bench [--drones D] [--ticks T] [--threads N]"
+				" [--size S] [--seed S]\n");
+			return EXIT_FAILURE;
+		}
+	}
+
+	maxThreads = std::max(maxThreads, 1u);
+
+	WorldConfig config;
+	if (size > 0) {
+		config.sizeX = std::max(size, 10);
+		config.sizeZ = std::max(size, 10);
+	}
+
+	Simulation simulation;
+	simulation.setConfig(config);
+	simulation.restart(seed);
+
+	auto &terrain = simulation.getTerrain();
+
+	std::printf("world %d x %d, %d drones, %d ticks of %.1f ms, seed %u\n", terrain.getSizeX(),
+		terrain.getSizeZ(), nrDrones, nrTicks, SWARM_TICK * 1000.0, seed);
+	std::printf("threads  drone-ticks/s  ms/tick  matrices ms  speedup  deliveries  hash\n");
+
+	double baseRate = 0;
+	uint64_t baseHash = 0;
+	bool identical = true;
+
+	// Powers of two, then the maximum
+	std::vector<unsigned int> threadCounts;
+	for (unsigned int threads = 1; threads < maxThreads; threads *= 2) {
+		threadCounts.push_back(threads);
+	}
+	threadCounts.push_back(maxThreads);
+
+	std::vector<glm::mat4> bases;
+	std::vector<glm::mat4> blades;
+
+	for (unsigned int threads : threadCounts) {
+		obj3D::ThreadPool pool(threads);
+
+		double bestRate = 0;
+		double bestMatricesMs = 0;
+		Swarm::Stats stats;
+		uint64_t hash = 0;
+
+		for (int r = 0; r < 3; r++) {
+			Swarm swarm;
+			swarm.reset(terrain, nrDrones, seed, static_cast<float>(simulation.getWorldConfig().maxY));
+
+			for (int t = 0; t < nrTicks; t++) {
+				swarm.step(&pool);
+			}
+
+			auto start = Clock::now();
+			swarm.getMatrices(bases, blades, &pool);
+			double matricesMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+			stats = swarm.getStats();
+			hash = hashSwarm(swarm);
+
+			bestRate = std::max(bestRate, stats.droneTicksPerSecond());
+			bestMatricesMs = (r == 0) ? matricesMs : std::min(bestMatricesMs, matricesMs);
+		}
+
+		if (threads == 1) {
+			baseRate = bestRate;
+			baseHash = hash;
+		}
+		identical = identical && (hash == baseHash);
+
+		std::printf("%7u %14.0f %8.2f %12.2f %8.2f %11llu  %016llx%s\n", threads, bestRate,
+			nrDrones / bestRate * 1000.0, bestMatricesMs, bestRate / baseRate, stats.deliveries,
+			static_cast<unsigned long long>(hash), (hash == baseHash) ? "" : "  DIFFERENT");
+	}
+
+	return identical ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+#endif
@@ -0,0 +1,108 @@
+#include "worldConfig.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <algorithm>
+
+using namespace sim;
+
+/**
+ * Whole string as a base 10 integer
+ */
+static bool parseInt(const std::string &value, int &res)
+{
+	if (value.empty()) {
+		return false;
+	}
+
+	char *end = nullptr;
+	long parsed = std::strtol(value.c_str(), &end, 10);
+
+	if (*end != '\0' || parsed < 0 || parsed > 1000000) {
+		return false;
+	}
+
+	res = static_cast<int>(parsed);
+	return true;
+}
+
+static std::string trim(const std::string &s)
+{
+	size_t first = s.find_first_not_of(" \t\r");
+	if (first == std::string::npos) {
+		return "";
+	}
+
+	size_t last = s.find_last_not_of(" \t\r");
+	return s.substr(first, last - first + 1);
+}
+
+bool WorldConfig::set(const std::string &key, const std::string &value)
+{
+	std::string name = key;
+	std::replace(name.begin(), name.end(), '-', '_');
+
+	int parsed = 0;
+	if (!parseInt(value, parsed)) {
+		return false;
+	}
+
+	if (name == "size_x" && parsed >= 2) {
+		sizeX = parsed;
+	} else if (name == "size_z" && parsed >= 2) {
+		sizeZ = parsed;
+	} else if (name == "max_y" && parsed >= 1) {
+		maxY = parsed;
+	} else if (name == "tiles_per_obstacle") {
+		tilesPerObstacle = parsed;
+	} else {
+		return false;
+	}
+
+	return true;
+}
+
+bool WorldConfig::load(const std::string &path)
+{
+	std::ifstream in(path);
+	if (!in) {
+		return false;
+	}
+
+	std::string line;
+	while (std::getline(in, line)) {
+		line = trim(line.substr(0, line.find('#')));
+		if (line.empty()) {
+			continue;
+		}
+
+		size_t eq = line.find('=');
+		if (eq == std::string::npos || !set(trim(line.substr(0, eq)), trim(line.substr(eq + 1)))) {
+			std::fprintf(stderr, "%s: bad line \"%s\"\n", path.c_str(), line.c_str());
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool WorldConfig::parseArgs(int argc, char **argv)
+{
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+
+		if (arg.compare(0, 2, "--") != 0 || i + 1 >= argc) {
+			return false;
+		}
+
+		std::string key = arg.substr(2);
+		std::string value = argv[++i];
+
+		if (key == "config" ? !load(value) : !set(key, value)) {
+			return false;
+		}
+	}
+
+	return true;
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <string>
+
+// Defaults of WorldConfig
+#define MAP_SIZE_Z 100
+#define MAP_SIZE_X (MAP_SIZE_Z + 10)
+#define MAP_SIZE_Y 15
+
+#define MAP_TILES_PER_OBSTACLE 40
+
+namespace sim {
+
+	/**
+	 * Size and density of the generated worlds, read at run time
+	 *
+	 * Files hold one `key = value` per line, `#` starts a comment:
+	 *
+	 *   size_x = 500
+	 *   size_z = 500
+	 *   max_y = 15
+	 *   tiles_per_obstacle = 40
+	 *
+	 * On the command line the same keys are given as `--size-x 500`
+	 */
+	struct WorldConfig {
+		int sizeX = MAP_SIZE_X;
+		int sizeZ = MAP_SIZE_Z;
+
+		// Ceiling of the drone
+		int maxY = MAP_SIZE_Y;
+
+		// One obstacle for this many tiles, 0 for none
+		int tilesPerObstacle = MAP_TILES_PER_OBSTACLE;
+
+		inline int getNrObstacles() const
+		{
+			if (tilesPerObstacle <= 0) {
+				return 0;
+			}
+			return static_cast<int>(static_cast<long long>(sizeX) * sizeZ / tilesPerObstacle);
+		}
+
+		/**
+		 * Sets one key, with `-` and `_` both accepted as separators
+		 * Returns false, changing nothing, for an unknown key or a bad value
+		 */
+		bool set(const std::string &key, const std::string &value);
+
+		/**
+		 * Returns false if the file cannot be read or has a bad line,
+		 * the keys before it are kept
+		 */
+		bool load(const std::string &path);
+
+		/**
+		 * Reads `--config <file>` and `--<key> <value>` pairs from the
+		 * arguments. Returns false on the first one it does not know
+		 */
+		bool parseArgs(int argc, char **argv);
+	};
+
+} // namespace sim
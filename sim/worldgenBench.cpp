@@ -0,0 +1,118 @@
+/*
+ * Times Terrain::generate() on the same world with 1 to N threads and
+ * checks that every thread count builds exactly the same world.
+ *
+ *   tema2_worldgen_bench [size] [maxThreads] [repeats] [seed]
+ *
+ * The map is size x size tiles with the game's obstacle density.
+ * Prints one line per thread count, the time is the best of the repeats.
+ */
+
+#ifdef TEMA2_SIM_TOOLS
+
+#include "simulation.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+#include <algorithm>
+
+using namespace obj3D;
+
+/**
+ * FNV-1a over everything generate() builds
+ */
+static uint64_t hashBytes(uint64_t hash, const void *data, size_t size)
+{
+	auto bytes = static_cast<const unsigned char *>(data);
+
+	for (size_t i = 0; i < size; i++) {
+		hash = (hash ^ bytes[i]) * 1099511628211ull;
+	}
+	return hash;
+}
+
+static uint64_t hashWorld(const Terrain &terrain)
+{
+	uint64_t hash = 14695981039346656037ull;
+
+	auto &heights = terrain.getHeights().getValues();
+	hash = hashBytes(hash, heights.data(), heights.size() * sizeof(float));
+
+	for (auto &&chunk : terrain.getChunks()) {
+		hash = hashBytes(hash, chunk.vertices.data(), chunk.vertices.size() * sizeof(TerrainVertex));
+		hash = hashBytes(hash, chunk.indices.data(), chunk.indices.size() * sizeof(unsigned int));
+	}
+
+	for (auto &&group : terrain.getObstacleGroups()) {
+		hash = hashBytes(hash, group.matrices.data(), group.matrices.size() * sizeof(glm::mat4));
+	}
+
+	hash = hashBytes(hash, &terrain.target.pos, sizeof(terrain.target.pos));
+	return hash;
+}
+
+int main(int argc, char **argv)
+{
+	int size = (argc > 1) ? std::atoi(argv[1]) : 1000;
+	unsigned int maxThreads = (argc > 2) ? std::atoi(argv[2]) : std::thread::hardware_concurrency();
+	int repeats = (argc > 3) ? std::atoi(argv[3]) : 3;
+	unsigned int seed = (argc > 4) ? std::strtoul(argv[4], nullptr, 10) : 42;
+
+	size = std::max(size, 10);
+	maxThreads = std::max(maxThreads, 1u);
+	repeats = std::max(repeats, 1);
+
+	sim::WorldConfig config;
+	config.sizeX = size;
+	config.sizeZ = size;
+
+	int nrObstacles = config.getNrObstacles();
+
+	std::printf("world %d x %d, %d obstacles, seed %u\n", size, size, nrObstacles, seed);
+	std::printf("threads       ms  speedup  hash\n");
+
+	double baseMs = 0;
+	uint64_t baseHash = 0;
+	bool identical = true;
+
+	// Powers of two, then the maximum
+	std::vector<unsigned int> threadCounts;
+	for (unsigned int threads = 1; threads < maxThreads; threads *= 2) {
+		threadCounts.push_back(threads);
+	}
+	threadCounts.push_back(maxThreads);
+
+	for (unsigned int threads : threadCounts) {
+		ThreadPool pool(threads);
+		double bestMs = 0;
+		uint64_t hash = 0;
+
+		for (int r = 0; r < repeats; r++) {
+			Terrain terrain;
+
+			auto start = std::chrono::steady_clock::now();
+			terrain.generate(size, size, nrObstacles, seed, &pool);
+			std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+
+			hash = hashWorld(terrain);
+			bestMs = (r == 0) ? elapsed.count() : std::min(bestMs, elapsed.count());
+		}
+
+		if (threads == 1) {
+			baseMs = bestMs;
+			baseHash = hash;
+		}
+		identical = identical && (hash == baseHash);
+
+		std::printf("%7u %8.1f %8.2f  %016llx%s\n", threads, bestMs, baseMs / bestMs,
+			static_cast<unsigned long long>(hash), (hash == baseHash) ? "" : "  DIFFERENT");
+	}
+
+	return identical ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+#endif